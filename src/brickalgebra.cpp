@@ -1,36 +1,139 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstdio>
 #include <cstdlib>
+#include <map>
+#include <string.h>
 
 #include "brickalgebra.h"
+#include "brickvector.h"
 #include "permutation.h"
+#include "canonsearch.h"
 #include "app_path.h"
+#include "threads.h"
+#include "drawingfile.h"
+
+// number of drawings that are labelled in parallel before their flags are
+// added
+#define LABELLING_BATCH_SIZE 1024
+
+// The header of a snapshot file. It is followed by the flags (see
+// FlagStore::write), the orbit sizes, the frozen index and the direct
+// index.
+#define SNAPSHOT_MAGIC   "TURANALG"
+#define SNAPSHOT_VERSION 1
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t layout;     // sizeof(CFINT), MAXN and MAXK, one byte each
+  int32_t N, K, Nlabelled, Klabelled;
+  uint64_t drawingChecksum;
+};
+
+static uint32_t snapshot_layout() {
+  return sizeof(CFINT) | (MAXN << 8) | (MAXK << 16);
+}
+
+// The drawings first, ..., first + count - 1 of a batch are handed out
+// to the threads one at a time
+struct LabellingBatch {
+  const BrickAlgebra* algebra;
+  const FlagStore* drawings;
+  int first, count;
+  std::vector<std::vector<LabelledFlag> >* labelled;
+  std::vector<DedupeStatistics>* statistics;
+  int next;
+};
+
+// The drawings of K_{N,K} as packed vectors, read once and shared by all
+// algebras with N top and K bottom vertices, and the checksum of the file
+// they were read from
+struct DrawingSet {
+  FlagStore drawings;
+  uint64_t checksum;
+};
+
+static const DrawingSet& drawing_set(int N, int K) {
+  static std::map<std::pair<int, int>, DrawingSet*> drawingSets;
+
+  DrawingSet*& set = drawingSets[std::make_pair(N, K)];
+  if (set != NULL)
+    return *set;
+
+  // the drawings are read from the binary drawing file if there is one,
+  // and from the text file otherwise
+  DrawingReader drawingsFile;
+
+  std::stringstream filename;
+  filename << get_app_path() << "../dr" << N << K;
+
+  if (!drawingsFile.open(filename.str() + ".bin") && !drawingsFile.open(filename.str() + ".txt"))
+    fatal_error( "Could not open file " + filename.str() + ".txt" )
+
+  set = new DrawingSet();
+  set->checksum = drawingsFile.checksum();
+  for (const CFINT* packed = drawingsFile.next(); packed != NULL; packed = drawingsFile.next())
+    set->drawings.add(Configuration(ConfigurationView(packed)));
+  return *set;
+}
 
 using namespace boost;
 
-BrickAlgebra::BrickAlgebra(int N, int K, int Nlabelled, int Klabelled) {
+BrickAlgebra::BrickAlgebra(int N, int K, int Nlabelled, int Klabelled)
+  : flagIndexMap(&flagList), frozenIndex(&flagList) {
   this->N = N;
   this->K = K;
   this->Nlabelled = Nlabelled;
   this->Klabelled = Klabelled;
 }
 
-void BrickAlgebra::constructElements() {
-  this->flagList.clear();
-  this->flagIndexMap.clear();
-
-  std::ifstream drawingsFile;
+const BrickAlgebra& BrickAlgebra::shared(int N, int K, int Nlabelled, int Klabelled) {
+  static std::map<std::vector<int>, BrickAlgebra*> algebras;
 
-  std::stringstream filename;
-  filename << get_app_path() << "../dr" << N << K << ".txt";
+  std::vector<int> key(4);
+  key[0] = N;
+  key[1] = K;
+  key[2] = Nlabelled;
+  key[3] = Klabelled;
 
-  drawingsFile.open(filename.str().c_str());
+  BrickAlgebra*& algebra = algebras[key];
+  if (algebra == NULL) {
+    algebra = new BrickAlgebra(N, K, Nlabelled, Klabelled);
+    algebra->constructElements();
+  }
+  return *algebra;
+}
 
-  if (!drawingsFile)
-    fatal_error( "Could not open file " + filename.str() )
+void BrickAlgebra::constructElements() {
+  this->flagList.clear();
+  this->snapshot.close();
+  this->flagIndexMap.clear();
+  this->frozenIndex.clear();
+  this->directIndex.clear();
+  this->orbitSizes.clear();
+  this->statistics.lookups = 0;
+  this->statistics.resolvedByOrbit = 0;
+
+  // the drawings are shared with the other algebras of the same size
+  const DrawingSet& drawingSet = drawing_set(N, K);
+  const FlagStore& drawings = drawingSet.drawings;
+
+  // if the algebra has been generated from the same drawings before, it
+  // is loaded instead
+  uint64_t drawingChecksum = drawingSet.checksum;
+  if (loadSnapshot(drawingChecksum)) {
+#if VERBOSITY >= 2
+    std::cout << "Loaded flag algebra (" << N << "," << K << "," << Nlabelled << "," << Klabelled << ") from "
+              << snapshotFileName() << " (" << this->flagList.size() << " flags)." << std::endl;
+#endif
+    writeToFile();
+    return;
+  }
 
-    CFINT vector[1024];
+  int threadCount = get_thread_count();
 
 #if VERBOSITY >= 2
   std::cout << "Generating flag algebra (" << N << "," << K << ","
@@ -39,58 +142,264 @@ void BrickAlgebra::constructElements() {
 
   int drawingCount = 0;
 
-  /* Read drawings from the input file */
-  while (!drawingsFile.eof()) {
-    // read N, K, Nlabelled, Klabelled
-    int number;
-    for (int i = 0; i < 4; i++) {
-      // notice that we read an int but store a CFINT,
-      // in case CFINT is a char
-      drawingsFile >> number;
-      vector[i] = static_cast<CFINT>(number);
-    }
-
-    // if end of file, stop
-    if (drawingsFile.eof())
-      break;
-
-    // read number of crossings
-    int crossingCount;
-    drawingsFile >> crossingCount;
-    vector[4] = static_cast<CFINT>(crossingCount);
+  // the labelled configurations of the drawings of a batch
+  std::vector<std::vector<LabelledFlag> > labelled(LABELLING_BATCH_SIZE);
+  std::vector<DedupeStatistics> threadStatistics(threadCount);
 
-    // check that the number of crossings is not outrageous
-    if (vector[4] > 120)
-      fatal_error("Trying to read a drawing with more than 120 crossings. Something must be wrong!");
+  for (int first = 0; first < drawings.size(); first += LABELLING_BATCH_SIZE) {
+    int count = std::min<int>(LABELLING_BATCH_SIZE, drawings.size() - first);
 
+    /* Label the drawings of the batch on all threads, and add their
+       flags in the order of the drawings, so that the flags get the
+       same indices for any number of threads. */
+    LabellingBatch batch = { this, &drawings, first, count, &labelled, &threadStatistics, 0 };
+    run_parallel(labelDrawings, &batch, std::min<int>(threadCount, count));
 
-    // read crossings
-    for (int i = 0; i < crossingCount * 4; i++) {
-      drawingsFile >> number;
-      vector[5 + i] = static_cast<CFINT>(number);
-    }
-
-    // save vector as configuration object and insert canonical form
-    // into the set of elements
-    Configuration config(vector);
-    addLabelledConfigurations(config);
+    for (int d = 0; d < count; d++) {
+      for (int i = 0; i < labelled[d].size(); i++)
+        addLabelledFlag(labelled[d][i]);
 
-    drawingCount++;
+      drawingCount++;
 
 #if VERBOSITY >= 2
-    if ((drawingCount % 100) == 0) std::cout << "." << std::flush;
+      if ((drawingCount % 100) == 0) std::cout << "." << std::flush;
 #endif
+    }
+  }
+
+  for (int t = 0; t < threadCount; t++) {
+    this->statistics.lookups += threadStatistics[t].lookups;
+    this->statistics.resolvedByOrbit += threadStatistics[t].resolvedByOrbit;
   }
 
   assert(this->flagList.size() == this->flagIndexMap.size());
 
 #if VERBOSITY >= 2
-  std::cout << " Generated " << this->flagList.size() << " flags (" << drawingCount << " drawings read)." << std::endl;
+  std::cout << " Generated " << this->flagList.size() << " flags (" << drawingCount << " drawings read";
+  if (threadCount > 1)
+    std::cout << ", " << threadCount << " threads";
+  std::cout << ")." << std::endl;
+#endif
+#if VERBOSITY >= 3
+  std::cout << "  " << statistics.lookups << " labelled configurations: "
+            << statistics.resolvedByOrbit << " skipped by symmetry." << std::endl;
 #endif
   writeToFile();
+  freeze();
+  saveSnapshot(drawingChecksum);
+}
+
+void BrickAlgebra::freeze() {
+  buildDirectIndex();
+  if (this->frozenIndex.build())
+    this->flagIndexMap.clear();
+}
+
+std::string BrickAlgebra::snapshotFileName() const {
+  std::stringstream fileName;
+  fileName << "algebra" << N << K << Nlabelled << Klabelled << ".bin";
+  return fileName.str();
+}
+
+bool BrickAlgebra::loadSnapshot(uint64_t drawingChecksum) {
+  if (!this->snapshot.open(snapshotFileName()))
+    return false;
+
+  // a snapshot of another algebra, of other drawings or from another
+  // version of the program is ignored
+  SnapshotHeader header;
+  bool valid = (this->snapshot.size() >= sizeof(header));
+  if (valid) {
+    memcpy(&header, this->snapshot.begin(), sizeof(header));
+    valid = (memcmp(header.magic, SNAPSHOT_MAGIC, 8) == 0) && (header.version == SNAPSHOT_VERSION)
+            && (header.layout == snapshot_layout()) && (header.N == N) && (header.K == K)
+            && (header.Nlabelled == Nlabelled) && (header.Klabelled == Klabelled)
+            && (header.drawingChecksum == drawingChecksum);
+  }
+  if (!valid) {
+    this->snapshot.close();
+    return false;
+  }
+
+  // the flags are used where they are in the snapshot; the orbit sizes
+  // and the indices are read from it
+  const char* data = this->flagList.attach(this->snapshot.begin() + sizeof(header), this->snapshot.end());
+  bool loaded = (data != NULL);
+  if (loaded) {
+    MemoryStreamBuffer buffer(data, this->snapshot.end());
+    std::istream stream(&buffer);
+    this->orbitSizes.resize(this->flagList.size());
+    if (this->flagList.size() > 0)
+      stream.read((char*) &this->orbitSizes[0], sizeof(int) * this->flagList.size());
+    loaded = stream && this->frozenIndex.read(stream) && readDirectIndex(stream);
+  }
+
+  if (!loaded) {
+    // a damaged snapshot is replaced
+    this->flagList.clear();
+    this->orbitSizes.clear();
+    this->frozenIndex.clear();
+    this->directIndex.clear();
+    this->snapshot.close();
+  }
+  return loaded;
+}
+
+void BrickAlgebra::saveSnapshot(uint64_t drawingChecksum) const {
+  // without a frozen index (two flags with the same hash) the algebra is
+  // generated every time
+  if (!this->frozenIndex.isBuilt())
+    return;
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+  header.version = SNAPSHOT_VERSION;
+  header.layout = snapshot_layout();
+  header.N = N;
+  header.K = K;
+  header.Nlabelled = Nlabelled;
+  header.Klabelled = Klabelled;
+  header.drawingChecksum = drawingChecksum;
+
+  // the snapshot is written to a temporary file that then replaces it, so
+  // that a process that has the old snapshot mapped keeps reading it, and
+  // a write that is cut short does not leave a partial snapshot
+  std::string fileName = snapshotFileName();
+  std::string tempFileName = fileName + ".tmp";
+  std::ofstream file(tempFileName.c_str(), std::ios::binary);
+  file.write((const char*) &header, sizeof(header));
+  this->flagList.write(file);
+  if (this->flagList.size() > 0)
+    file.write((const char*) &this->orbitSizes[0], sizeof(int) * this->flagList.size());
+  this->frozenIndex.write(file);
+  writeDirectIndex(file);
+  file.close();
+
+  if (!file || (rename(tempFileName.c_str(), fileName.c_str()) != 0))
+    remove(tempFileName.c_str());
 }
 
-void BrickAlgebra::addLabelledConfigurations(const Configuration& config) {
+void BrickAlgebra::buildDirectIndex() {
+  this->directIndex.clear();
+  int pairs = CrossingSet::shapePairCount(N, K);
+  if (pairs > DIRECTINDEX_MAX_PAIRS)
+    return;
+
+  this->directIndex.assign(1 << pairs, -1);
+
+  // every labelled configuration of a flag is obtained by permuting its
+  // unlabelled vertices
+  for (int F = 0; F < this->flagList.size(); F++) {
+    CrossingSet flag(this->flagList[F]);
+
+    CFINT newIndexN[N], newIndexK[K];
+    for (int i = 0; i < N; i++) newIndexN[i] = i;
+    do {
+      for (int i = 0; i < K; i++) newIndexK[i] = i;
+      do {
+        CrossingSet crossings = flag;
+        crossings.relabel(newIndexN, newIndexK);
+        this->directIndex[crossings.shapeIndex(N, K)] = F;
+      } while (advancePermutation(newIndexK, Klabelled, K));
+    } while (advancePermutation(newIndexN, Nlabelled, N));
+  }
+}
+
+bool BrickAlgebra::readDirectIndex(std::istream& stream) {
+  int pairs = CrossingSet::shapePairCount(N, K);
+  uint32_t length;
+  stream.read((char*) &length, sizeof(length));
+  if (!stream || (length != ((pairs > DIRECTINDEX_MAX_PAIRS) ? 0u : (1u << pairs))))
+    return false;
+
+  this->directIndex.resize(length);
+  if (length > 0)
+    stream.read((char*) &this->directIndex[0], sizeof(int) * length);
+
+  // every entry is a flag index, or -1
+  bool valid = !stream.fail();
+  for (uint32_t i = 0; valid && (i < length); i++)
+    valid = (this->directIndex[i] >= -1) && (this->directIndex[i] < this->flagList.size());
+  if (!valid) {
+    this->directIndex.clear();
+    return false;
+  }
+  return true;
+}
+
+void BrickAlgebra::writeDirectIndex(std::ostream& stream) const {
+  uint32_t length = this->directIndex.size();
+  stream.write((const char*) &length, sizeof(length));
+  if (length > 0)
+    stream.write((const char*) &this->directIndex[0], sizeof(int) * length);
+}
+
+void BrickAlgebra::labelDrawings(void* argument, int thread, int) {
+  LabellingBatch* batch = (LabellingBatch*) argument;
+  DedupeStatistics& threadStatistics = (*batch->statistics)[thread];
+  while (true) {
+    int d = __sync_fetch_and_add(&batch->next, 1);
+    if (d >= batch->count)
+      break;
+    (*batch->labelled)[d].clear();
+    Configuration drawing((*batch->drawings)[batch->first + d]);
+    batch->algebra->labelConfiguration(drawing, (*batch->labelled)[d], threadStatistics);
+  }
+}
+
+// Returns the index of an ordered subset of {0, ..., n-1} of size count
+// among all n!/(n-count)! ordered subsets
+static int rankOrderedSubset(const CFINT* subset, int n, int count) {
+  bool used[n];
+  for (int v = 0; v < n; v++)
+    used[v] = false;
+
+  int rank = 0;
+  for (int i = 0; i < count; i++) {
+    int position = 0;
+    for (int v = 0; v < subset[i]; v++)
+      if (!used[v])
+        position++;
+    rank = rank * (n - i) + position;
+    used[subset[i]] = true;
+  }
+  return rank;
+}
+
+#ifdef DEBUG
+// Lists all elements of the automorphism group described by the
+// generators in labelling, as N top images followed by K bottom images
+static void enumerateAutomorphisms(const CanonicalLabelling& labelling, int N, int K,
+                                   std::vector<CFINT>& elements) {
+  std::vector<bool> seen(factorial(N) * factorial(K), false);
+  elements.clear();
+  for (int i = 0; i < N; i++)
+    elements.push_back(i);
+  for (int i = 0; i < K; i++)
+    elements.push_back(i);
+  seen[0] = true;
+
+  for (int e = 0; e < elements.size(); e += N + K) {
+    for (int g = 0; g < labelling.generatorCount; g++) {
+      CFINT image[N + K];
+      for (int i = 0; i < N; i++)
+        image[i] = labelling.generatorN[g][elements[e + i]];
+      for (int i = 0; i < K; i++)
+        image[N + i] = labelling.generatorK[g][elements[e + N + i]];
+
+      int rank = rankOrderedSubset(image, N, N) * factorial(K) + rankOrderedSubset(image + N, K, K);
+      if (!seen[rank]) {
+        seen[rank] = true;
+        elements.insert(elements.end(), image, image + N + K);
+      }
+    }
+  }
+}
+#endif
+
+void BrickAlgebra::labelConfiguration(const Configuration& config, std::vector<LabelledFlag>& labelled,
+                                      DedupeStatistics& labelStatistics) const {
   /* The following code generates all combinations of:
      (1) ordered subsets labelN of {0, ..., N-1} of size Nlabelled, and
      (2) ordered subsets labelK of {0, ..., K-1} of size Klabelled.
@@ -98,9 +407,36 @@ void BrickAlgebra::addLabelledConfigurations(const Configuration& config) {
      The meaning of each set labelN is: we will label the labelN[i]'th
   	   unlabelled top vertex with label i. Similarly, we will label the
      labelK[j]'th unlabelled bottom vertex with label j.
+
+     An automorphism of the drawing maps a labelling onto a labelling that
+     gives the same configuration, and labellings that are not related by
+     an automorphism give different configurations. Therefore, only one
+     labelling of every orbit of the automorphism group is turned into a
+     flag; the size of the orbit is recorded with the flag.
   */
 
+  int labellingsN = factorial(N) / factorial(N - Nlabelled);
+  int labellingsK = factorial(K) / factorial(K - Klabelled);
+
+  // the automorphism group of the drawing; if nothing is labelled there
+  // is only one labelling, so the group is not needed
+  CanonicalLabelling automorphisms;
+  automorphisms.generatorCount = 0;
+  if ((Nlabelled > 0) || (Klabelled > 0)) {
+    Configuration canonical(config);
+    canonical.putInCanonicalForm(false, automorphisms);
+  }
+
+#ifdef DEBUG
+  std::vector<CFINT> groupElements;
+  enumerateAutomorphisms(automorphisms, N, K, groupElements);
+  int groupOrder = groupElements.size() / (N + K);
+#endif
+
   int totalPermutations = 0; // counter for checking purposes
+  int width = Nlabelled + Klabelled;
+  std::vector<bool> visited(labellingsN * labellingsK, false);
+  std::vector<CFINT> orbit;
 
   // data structures needed for generating subsets of {0, ..., N-1}
   CFINT seqN[N];
@@ -119,33 +455,90 @@ void BrickAlgebra::addLabelledConfigurations(const Configuration& config) {
   CFINT labelN[Nlabelled];
   subsetBuffer<CFINT> bufferN(seqN, N, Nlabelled);
   while (nextOrderedSubset(labelN, bufferN)) {
-    // we now have the set labelN; fix the vertices accordingly
-    Configuration configNlabelled = config;
-    configNlabelled.labelNvertices(labelN, Nlabelled);
+    int rankN = rankOrderedSubset(labelN, N, Nlabelled);
+    Configuration configNlabelled;
+    bool configNlabelledSet = false;
 
     // data structures needed for generating ordered  subsets of {0, ..., N-1}*/
     CFINT labelK[Klabelled];
     subsetBuffer<CFINT> bufferK(seqK, K, Klabelled);
     while (nextOrderedSubset(labelK, bufferK)) {
-      totalPermutations++;
-
-      // we now have the set labelK; fix the vertices accordingly
-      Configuration configLabelled(configNlabelled);
-      configLabelled.labelKvertices(labelK, Klabelled);
-      configLabelled.putInCanonicalForm(false);
-
-      // see if this canonical form is already in the set of known flags
-      if (this->flagIndexMap.find(configLabelled) == this->flagIndexMap.end()) {
-        // if not, add the labelled configuration to the set of elements,
-        // in its canonical form
-        int flagIndex = this->flagList.size();
-        this->flagIndexMap.insert(std::make_pair<Configuration,int>(configLabelled, flagIndex));
-        this->flagList.push_back(configLabelled);
+      labelStatistics.lookups++;
+
+      int rank = rankN * labellingsK + rankOrderedSubset(labelK, K, Klabelled);
+      if (visited[rank]) {
+        labelStatistics.resolvedByOrbit++;
+        continue;
+      }
+
+      // collect the orbit of this labelling under the automorphisms
+      visited[rank] = true;
+      orbit.assign(labelN, labelN + Nlabelled);
+      orbit.insert(orbit.end(), labelK, labelK + Klabelled);
+      for (int o = 0; o < orbit.size(); o += width) {
+        for (int g = 0; g < automorphisms.generatorCount; g++) {
+          CFINT image[width];
+          for (int i = 0; i < Nlabelled; i++)
+            image[i] = automorphisms.generatorN[g][orbit[o + i]];
+          for (int i = 0; i < Klabelled; i++)
+            image[Nlabelled + i] = automorphisms.generatorK[g][orbit[o + Nlabelled + i]];
+
+          int imageRank = rankOrderedSubset(image, N, Nlabelled) * labellingsK
+                          + rankOrderedSubset(image + Nlabelled, K, Klabelled);
+          if (!visited[imageRank]) {
+            visited[imageRank] = true;
+            orbit.insert(orbit.end(), image, image + width);
+          }
+        }
+      }
+      int orbitSize = (width > 0) ? orbit.size() / width : 1;
+      totalPermutations += orbitSize;
+
+#ifdef DEBUG
+      // orbit-stabilizer: the automorphisms that fix the labelled vertices
+      // make up a subgroup of index orbitSize
+      int stabilizerOrder = 0;
+      for (int e = 0; e < groupElements.size(); e += N + K) {
+        bool fixes = true;
+        for (int i = 0; i < Nlabelled; i++)
+          fixes = fixes && (groupElements[e + labelN[i]] == labelN[i]);
+        for (int i = 0; i < Klabelled; i++)
+          fixes = fixes && (groupElements[e + N + labelK[i]] == labelK[i]);
+        if (fixes)
+          stabilizerOrder++;
+      }
+      assert(orbitSize * stabilizerOrder == groupOrder);
+#endif
+
+      // we now have the sets labelN and labelK; fix the vertices accordingly
+      if (!configNlabelledSet) {
+        configNlabelled = config;
+        configNlabelled.labelNvertices(labelN, Nlabelled);
+        configNlabelledSet = true;
       }
+      LabelledFlag flag;
+      flag.config = configNlabelled;
+      flag.config.labelKvertices(labelK, Klabelled);
+      flag.config.putInCanonicalForm(false);
+      flag.orbitSize = orbitSize;
+      labelled.push_back(flag);
     }
   }
 
-  assert(totalPermutations == factorial(N) * factorial(K) / factorial(N - Nlabelled) / factorial(K - Klabelled));
+  // the orbits partition the set of labellings
+  assert(totalPermutations == labellingsN * labellingsK);
+}
+
+void BrickAlgebra::addLabelledFlag(const LabelledFlag& labelled) {
+  // see if this canonical form is already in the set of known flags
+  if (this->flagIndexMap.find(labelled.config.packedVector()) >= 0)
+    return;
+
+  // if not, add the labelled configuration to the set of elements, in its
+  // canonical form
+  int flagIndex = this->flagList.add(labelled.config);
+  this->flagIndexMap.insert(flagIndex);
+  this->orbitSizes.push_back(labelled.orbitSize);
 }
 
 
@@ -163,17 +556,41 @@ void BrickAlgebra::writeToTextStream(std::ostream& stream) const {
     stream << (i+1) << ": " << this->flagList[i] << std::endl;
 }
 
-const std::vector<Configuration>& BrickAlgebra::getFlagList() const {
+const FlagStore& BrickAlgebra::getFlagList() const {
   return this->flagList;
 }
 
 int BrickAlgebra::getIndex(const Configuration& config) const {
-  unordered_map<Configuration, int, configuration_hash>::const_iterator iterator = this->flagIndexMap.find(config);
-  if (iterator == this->flagIndexMap.end())
-    return -1;
-  return iterator->second;
+  if (this->frozenIndex.isBuilt())
+    return this->frozenIndex.find(config.packedVector());
+  return this->flagIndexMap.find(config.packedVector());
 }
 
+int BrickAlgebra::getIndex(const CrossingSet& crossings) const {
+  if (!this->directIndex.empty() && (crossings.getN() == N) && (crossings.getK() == K)
+      && (crossings.getNlabelled() == Nlabelled) && (crossings.getKlabelled() == Klabelled)) {
+    int index = this->directIndex[crossings.shapeIndex(N, K)];
+#ifdef DEBUG
+    Configuration config = crossings.toConfiguration();
+    config.putInCanonicalForm(false);
+    assert(index == getIndex(config));
+#endif
+    return index;
+  }
+
+  Configuration config = crossings.toConfiguration();
+  config.putInCanonicalForm(false);
+  return getIndex(config);
+}
+
+
+int BrickAlgebra::getOrbitSize(int flagIndex) const {
+  return this->orbitSizes[flagIndex];
+}
+
+const DedupeStatistics& BrickAlgebra::getDedupeStatistics() const {
+  return this->statistics;
+}
 
 int BrickAlgebra::size() const {
   return this->flagList.size();
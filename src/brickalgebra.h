@@ -3,38 +3,121 @@
 
 #include <boost/unordered_map.hpp>
 #include <vector>
-#include <ostream>
+#include <iostream>
 
 #include "configuration.h"
+#include "crossingset.h"
+#include "flagstore.h"
+#include "mappedfile.h"
 #include "turan.h"
 
+// Algebras whose configurations have at most this many pairs of edges
+// that can cross get a table from crossing sets to flag indices (of 4 <<
+// DIRECTINDEX_MAX_PAIRS bytes)
+#define DIRECTINDEX_MAX_PAIRS 20
+
+// Counters that show how the labelled configurations were identified
+// while the elements of an algebra were constructed
+struct DedupeStatistics {
+  int lookups;                 // labellings of the drawings
+  int resolvedByOrbit;         // image of an earlier labelling under an automorphism
+};
+
+// A labelled configuration of a drawing in canonical form, as produced by
+// the threads that construct an algebra, before it is added as a flag
+struct LabelledFlag {
+  Configuration config;
+  int orbitSize;
+};
+
 class BrickAlgebra {
  private:
   int N, K, Nlabelled, Klabelled;
 
   // list of all flags
-  std::vector<Configuration> flagList;
+  FlagStore flagList;
+
+  // for every flag, the number of labellings of its drawing that give it
+  std::vector<int> orbitSizes;
+
+  // mapping from configuration to index, used while the flags are
+  // generated
+  FlagIndex flagIndexMap;
+
+  // mapping from configuration to index once all flags are known
+  FrozenFlagIndex frozenIndex;
+
+  // for algebras with at most DIRECTINDEX_MAX_PAIRS pairs of edges that
+  // can cross: the index of the flag of every labelled crossing set (or
+  // -1 if it is not a drawing), by CrossingSet::shapeIndex
+  std::vector<int> directIndex;
+
+  DedupeStatistics statistics;
 
-  // mapping from configuration to index
-  boost::unordered_map<Configuration, int, configuration_hash> flagIndexMap;
+  // computes one labelled configuration for every orbit of labellings
+  // of a drawing; this only reads the algebra, so that drawings can be
+  // labelled on several threads at once
+  void labelConfiguration(const Configuration& config, std::vector<LabelledFlag>& labelled,
+                          DedupeStatistics& labelStatistics) const;
 
-  void addLabelledConfigurations(const Configuration& config);
+  // adds a labelled configuration as a flag, unless it is one already
+  void addLabelledFlag(const LabelledFlag& labelled);
+
+  static void labelDrawings(void* argument, int thread, int threadCount);
+
+  // replaces flagIndexMap by frozenIndex, and builds the direct index
+  void freeze();
+
+  // the snapshot file that the flags were loaded from, if any
+  MappedFile snapshot;
+
+  // A snapshot (algebraNKnk.bin) holds the flags, their orbit sizes and
+  // the indices, and the checksum of the drawing file they were
+  // generated from. loadSnapshot returns false if there is no snapshot
+  // for this algebra and drawing file.
+  std::string snapshotFileName() const;
+  bool loadSnapshot(uint64_t drawingChecksum);
+  void saveSnapshot(uint64_t drawingChecksum) const;
+
+  void buildDirectIndex();
+  bool readDirectIndex(std::istream& stream);
+  void writeDirectIndex(std::ostream& stream) const;
+
+  // the index set refers to flagList, so an algebra cannot be copied
+  BrickAlgebra(const BrickAlgebra&);
+  BrickAlgebra& operator = (const BrickAlgebra&);
 
  public:
   BrickAlgebra(int N, int K, int Nlabelled, int Klabelled);
   void constructElements();
 
+  // Returns the algebra with the given parameters, which is constructed
+  // the first time it is asked for. These algebras are shared by the
+  // whole program and are never changed or destroyed. Not thread-safe.
+  static const BrickAlgebra& shared(int N, int K, int Nlabelled, int Klabelled);
+
   void writeToTextStream(std::ostream& stream) const;
   void writeToFile() const;
 
-  const std::vector<Configuration>& getFlagList() const;
+  const FlagStore& getFlagList() const;
 
-  const Configuration& operator[] (const int nIndex) {
+  ConfigurationView operator[] (const int nIndex) const {
     return flagList[nIndex];
   }
 
   int getIndex(const Configuration& config) const;
 
+  // returns the index of the flag of a labelled configuration that is not
+  // in canonical form; for small algebras this is a table lookup
+  int getIndex(const CrossingSet& crossings) const;
+
+  // returns the number of labellings of the underlying drawing that give
+  // the flag with the given index, i.e. the size of its orbit under the
+  // automorphism group of the drawing
+  int getOrbitSize(int flagIndex) const;
+
+  const DedupeStatistics& getDedupeStatistics() const;
+
   // returns the number of flags in the algebra
   int size() const;
 
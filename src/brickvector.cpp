@@ -1,31 +1,12 @@
+#include <algorithm>
 #include <iostream>
 #include <string.h>
 
 #include "brickvector.h"
 #include "lex_sort.h"
 #include "permutation.h"
-
-/* Macros to extract information from brick flags */
-inline int getN(const CFINT* vector)             {
-  return vector[0];
-}
-inline int getK(const CFINT* vector)             {
-  return vector[1];
-}
-inline int getNlabelled(const CFINT* vector)     {
-  return vector[2];
-}
-inline int getKlabelled(const CFINT* vector)     {
-  return vector[3];
-}
-inline int getCrossingCount(const CFINT* vector) {
-  return vector[4];
-}
-inline int getLength(const CFINT* vector)        {
-  return 5 + getCrossingCount(vector) * 4;
-}
-
-#define CROSSING_OFFSET          5
+#include "canonsearch.h"
+#include "canonkernel.h"
 
 std::string topvertices    = "abcdef";
 std::string bottomvertices = "wxyz";
@@ -97,6 +78,86 @@ std::size_t vector_hash_value(const CFINT* vector) {
   return seed;
 }
 
+void pack_vector(const CFINT* vector, CFINT* packed) {
+  int crossingcount = getCrossingCount(vector);
+  memcpy(packed, vector, sizeof(CFINT) * CROSSING_OFFSET);
+  for (int i = 0; i < crossingcount; i++)
+    packed[CROSSING_OFFSET + i] = crossing_key(&vector[CROSSING_OFFSET + 4 * i]);
+}
+
+void unpack_vector(const CFINT* packed, CFINT* vector) {
+  int crossingcount = getCrossingCount(packed);
+  memcpy(vector, packed, sizeof(CFINT) * CROSSING_OFFSET);
+  for (int i = 0; i < crossingcount; i++)
+    unpack_crossing_key(packed[CROSSING_OFFSET + i], &vector[CROSSING_OFFSET + 4 * i]);
+}
+
+CFINT* copy_packed_vector(const CFINT* packed) {
+  CFINT* new_packed = new CFINT[getPackedLength(packed)];
+  memcpy(new_packed, packed, sizeof(CFINT) * getPackedLength(packed));
+  return new_packed;
+}
+
+// Same as sort_crossings, for a packed vector: the two edges of a crossing
+// are the two 6-bit halves of its key
+void sort_packed_crossings(CFINT* packed) {
+  int crossingcount = getCrossingCount(packed);
+  CFINT* keys = &packed[CROSSING_OFFSET];
+
+  for (int i = 0; i < crossingcount; i++)
+    keys[i] = (CFINT) packCrossing(keys[i] >> 6, keys[i] & 63);
+
+  sort_crossing_keys(keys, crossingcount);
+  SANITY_CHECK_PACKED(packed);
+}
+
+bool packed_vectors_equals(const CFINT* a, const CFINT* b) {
+  if (a == NULL)
+    return b == NULL;
+  if (b == NULL)
+    return false;
+
+  if (getCrossingCount(a) != getCrossingCount(b))
+    return false;
+
+  return memcmp(a, b, sizeof(CFINT) * getPackedLength(a)) == 0;
+}
+
+std::size_t packed_vector_hash_value(const CFINT* packed) {
+  if (packed == NULL) return 0;
+  return (std::size_t) packed_vector_hash64(packed);
+}
+
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+inline uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// 64-bit hash of a packed vector. The entries are read four at a time as
+// 64-bit words, each word is mixed in as in a round of xxHash64, and the
+// result is finalized with the MurmurHash3 avalanche step. The length is
+// part of the seed, so the zero padding of the last word is harmless.
+uint64_t packed_vector_hash64(const CFINT* packed) {
+  int len = getPackedLength(packed);
+  uint64_t h = HASH_PRIME2 ^ ((uint64_t) len * HASH_PRIME1);
+
+  for (int i = 0; i < len; i += 4) {
+    uint64_t word = 0;
+    memcpy(&word, &packed[i], sizeof(CFINT) * std::min(4, len - i));
+    word = rotl64(word * HASH_PRIME2, 31) * HASH_PRIME1;
+    h = rotl64(h ^ word, 27) * HASH_PRIME1 + HASH_PRIME2;
+  }
+
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
 void sanity_check_error(CFINT* vector, const std::string str, int line_no, const std::string fileName) {
   std::cerr << "Sanity check '" << str << "' at " << fileName << ":" << line_no << " failed on: " << std::endl;
   print_vector(vector);
@@ -146,19 +207,174 @@ void sanity_check(CFINT* vector, int line_no, const std::string fileName) {
 #endif // DEBUG
 }
 
-inline void sort_crossings(CFINT* vector) {
+void sanity_check_packed(const CFINT* packed, int line_no, const std::string fileName) {
+#ifdef DEBUG
+  CFINT vector[getLength(packed)];
+  unpack_vector(packed, vector);
+  sanity_check(vector, line_no, fileName);
+#endif // DEBUG
+}
+
+void sort_crossings(CFINT* vector) {
   int crossingcount = getCrossingCount(vector);
+  CFINT* crossings = &vector[CROSSING_OFFSET];
 
-  // first sort the endpoints of the edges
-  for (int i = 0; i < crossingcount; i++)
-    lex_sort(&vector[CROSSING_OFFSET + 4*i], 2, 2);
+  // pack every crossing, with its edges in order, into a key that
+  // compares like the crossing; sort the keys, and unpack them again
+  CFINT keys[crossingcount];
+  for (int i = 0; i < crossingcount; i++) {
+    CFINT* cr = &crossings[4 * i];
+    keys[i] = (CFINT) packCrossing(packEdge(cr[0], cr[1]), packEdge(cr[2], cr[3]));
+  }
+
+  sort_crossing_keys(keys, crossingcount);
 
-  lex_sort(&vector[CROSSING_OFFSET], crossingcount, 4);
+  for (int i = 0; i < crossingcount; i++)
+    unpack_crossing_key(keys[i], &crossings[4 * i]);
   SANITY_CHECK(vector);
 }
 
 
+// Number of permutations of the vertices that calc_canonical has to consider
+int canonical_permutation_count(const CFINT* vector, bool permuteLabelledVertices) {
+  int N = getN(vector), K = getK(vector),
+      Nlabelled = getNlabelled(vector),
+      Klabelled = getKlabelled(vector);
+
+  int count = factorial(N - Nlabelled) * factorial(K - Klabelled);
+  if (permuteLabelledVertices)
+    count *= factorial(Nlabelled) * factorial(Klabelled);
+  return count;
+}
+
+// Tables of the adjacent transpositions that run through the permutations
+// of n = 0, ..., MAXNK elements in Steinhaus-Johnson-Trotter order
+struct TranspositionTables {
+  CFINT table[MAXNK + 1][Factorial<MAXNK>::value];
+
+  TranspositionTables() {
+    for (int n = 0; n <= MAXNK; n++)
+      sjtTranspositions(table[n], n);
+  }
+};
+
+static TranspositionTables transpositions;
+
+// Exhaustive canonicalization kernels for every shape up to MAXN x MAXK
+typedef void (*CanonicalKernelFunction)(CFINT*, bool, const CFINT (*)[Factorial<MAXNK>::value]);
+
+template <int N, int K> struct KernelTableFiller {
+  static void fill(CanonicalKernelFunction (*table)[MAXK + 1]) {
+    table[N][K] = &CanonicalKernel<N, K>::exhaustive;
+    KernelTableFiller<N, K - 1>::fill(table);
+  }
+};
+
+template <int N> struct KernelTableFiller<N, -1> {
+  static void fill(CanonicalKernelFunction (*table)[MAXK + 1]) {
+    KernelTableFiller<N - 1, MAXK>::fill(table);
+  }
+};
+
+template <> struct KernelTableFiller<-1, MAXK> {
+  static void fill(CanonicalKernelFunction (*)[MAXK + 1]) { }
+};
+
+struct CanonicalKernelTable {
+  CanonicalKernelFunction table[MAXN + 1][MAXK + 1];
+
+  CanonicalKernelTable() {
+    KernelTableFiller<MAXN, MAXK>::fill(table);
+  }
+};
+
+static CanonicalKernelTable kernels;
+
+// Up to this many permutations, enumerating all of them in Gray code order
+// is faster than the search tree (this covers 3x4 drawings without labels)
+#define EXHAUSTIVE_PERMUTATION_LIMIT 144
+
 void calc_canonical(CFINT* vector, bool permuteLabelledVertices) {
+  bool exhaustive = (canonical_permutation_count(vector, permuteLabelledVertices) <= EXHAUSTIVE_PERMUTATION_LIMIT);
+
+#ifdef DEBUG
+  CFINT check_vector[getLength(vector)];
+  memcpy(check_vector, vector, sizeof(CFINT) * getLength(vector));
+  if (exhaustive)
+    search_canonical(check_vector, permuteLabelledVertices);
+  else
+    calc_canonical_exhaustive(check_vector, permuteLabelledVertices);
+#endif
+
+  if (exhaustive)
+    kernels.table[getN(vector)][getK(vector)](vector, permuteLabelledVertices, transpositions.table);
+  else
+    search_canonical(vector, permuteLabelledVertices);
+
+#ifdef DEBUG
+  if (!vectors_equals(vector, check_vector)) {
+    std::cerr << "Canonical search and exhaustive enumeration disagree:" << std::endl;
+    print_vector(vector, std::cerr);
+    std::cerr << std::endl;
+    print_vector(check_vector, std::cerr);
+    std::cerr << std::endl;
+    exit(1);
+  }
+#endif
+}
+
+// Exchanges the labels 'label' and 'label'+1 of the top vertices (offset = 0)
+// or bottom vertices (offset = 1) of a vector whose crossings are sorted,
+// and restores the order of the crossings. Only the crossings that involve
+// one of the two vertices change; these are relabelled in place, after
+// which an insertion sort moves them back into position.
+void swap_adjacent_labels(CFINT* vector, int offset, CFINT label) {
+  int crossingcount = getCrossingCount(vector);
+  CFINT* crossings = &vector[CROSSING_OFFSET];
+
+  for (int i = 0; i < crossingcount; i++) {
+    CFINT* cr = &crossings[4 * i];
+    bool touched = false;
+    if ((cr[offset] == label) || (cr[offset] == label + 1)) {
+      cr[offset] = 2 * label + 1 - cr[offset];
+      touched = true;
+    }
+    if ((cr[offset + 2] == label) || (cr[offset + 2] == label + 1)) {
+      cr[offset + 2] = 2 * label + 1 - cr[offset + 2];
+      touched = true;
+    }
+
+    // put the endpoints of the crossing back in order
+    if (touched && ((cr[0] > cr[2]) || ((cr[0] == cr[2]) && (cr[1] > cr[3])))) {
+      std::swap<CFINT>(cr[0], cr[2]);
+      std::swap<CFINT>(cr[1], cr[3]);
+    }
+  }
+
+  for (int i = 1; i < crossingcount; i++) {
+    CFINT cr[4];
+    memcpy(cr, &crossings[4 * i], sizeof(CFINT) * 4);
+    int j = i;
+    while ((j > 0) && (lex_compare(&crossings[4 * (j - 1)], cr, 4) > 0)) {
+      memcpy(&crossings[4 * j], &crossings[4 * (j - 1)], sizeof(CFINT) * 4);
+      j--;
+    }
+    if (j != i)
+      memcpy(&crossings[4 * j], cr, sizeof(CFINT) * 4);
+  }
+  SANITY_CHECK(vector);
+}
+
+// Computes the canonical form by trying every permutation of the
+// vertices. This is the reference implementation for search_canonical.
+//
+// The permutations are visited in an order in which consecutive
+// permutations differ by exchanging two adjacent labels: each of the
+// groups of labelled and unlabelled top and bottom vertices runs through
+// its permutations in Steinhaus-Johnson-Trotter order, and the groups
+// are combined in a reflected (boustrophedon) order. Every step is then
+// a small repair of the sorted crossings instead of a full sort.
+void calc_canonical_exhaustive(CFINT* vector, bool permuteLabelledVertices) {
   SANITY_CHECK(vector);
   int N = getN(vector), K = getK(vector),
       Nlabelled = getNlabelled(vector),
@@ -166,59 +382,66 @@ void calc_canonical(CFINT* vector, bool permuteLabelledVertices) {
       crossingcount = getCrossingCount(vector),
       len = getLength(vector);
 
-  CFINT permB[K], permA[N];
-
   CFINT new_vector[len], best_vector[len];
 
-  int vectorBytes = sizeof(CFINT) * getLength(vector); // length of vector in bytes
-
-  memcpy(best_vector, vector, vectorBytes);
-  memcpy(new_vector,  vector, vectorBytes);
-
-  for (CFINT n = 0; n < N; n++)
-    permA[n] = n;
-
-  int permutationCount = 0;
-  do {
-    do {
-      for (CFINT k = 0; k < K; k++)
-        permB[k] = k;
-      do {
-        do {
-          // crossings start at position 5
-          CFINT* new_ptr = &new_vector[CROSSING_OFFSET];
-          CFINT* ptr     = &vector[CROSSING_OFFSET];
-
-          // Perform permutation. This code looks scarier than it is:
-          // Each *(new_ptr++) refers to the current position in the
-          // array, and moves the pointer by one position.
-          for (int i = 0; i < crossingcount; i++) {
-            *(new_ptr++) = permA[*(ptr++)];
-            *(new_ptr++) = permB[*(ptr++)];
-            *(new_ptr++) = permA[*(ptr++)];
-            *(new_ptr++) = permB[*(ptr++)];
-          }
-
-          // sort the crossings
-          sort_crossings(new_vector);
-
-          // if the new crossings form a lexicographically smaller
-          // vector than the previously best known, then
-          // save this vector as the new best
-
-          permutationCount++;
-          if (lex_compare(&new_vector[CROSSING_OFFSET], &best_vector[CROSSING_OFFSET], 4 * crossingcount) < 0)
-            memcpy(best_vector, new_vector, vectorBytes);
-        } while (advancePermutation(permB, Klabelled, K));
-      } while (advancePermutation(permB, 0, permuteLabelledVertices ? Klabelled : 0));
-    } while (advancePermutation(permA, Nlabelled, N));
-  } while (advancePermutation(permA, 0, permuteLabelledVertices ? Nlabelled : 0));
+  int vectorBytes = sizeof(CFINT) * len; // length of vector in bytes
+
+  memcpy(new_vector, vector, vectorBytes);
+  sort_crossings(new_vector);
+  memcpy(best_vector, new_vector, vectorBytes);
+
+  // groups of vertices whose labels are permuted: the offset of their
+  // side within a crossing, their first label and their number
+  int groupOffset[4], groupFirst[4], groupSize[4];
+  int groupCount = 0;
+  int offsets[4] = { 0, 0, 1, 1 };
+  int firsts[4]  = { 0, Nlabelled, 0, Klabelled };
+  int sizes[4]   = { permuteLabelledVertices ? Nlabelled : 0, N - Nlabelled,
+                     permuteLabelledVertices ? Klabelled : 0, K - Klabelled };
+  for (int g = 0; g < 4; g++) {
+    if (sizes[g] <= 1)
+      continue;
+    groupOffset[groupCount] = offsets[g];
+    groupFirst[groupCount]  = firsts[g];
+    groupSize[groupCount]   = sizes[g];
+    groupCount++;
+  }
 
+  // position of each group in its Steinhaus-Johnson-Trotter order,
+  // and the direction in which it currently moves
+  int position[4], direction[4];
+  for (int g = 0; g < groupCount; g++) {
+    position[g] = 0;
+    direction[g] = 1;
+  }
 
-  memcpy(vector, best_vector, vectorBytes);
+  while (true) {
+    // find the last group that can still move in its direction;
+    // the groups after it turn around
+    int g = groupCount - 1;
+    while (g >= 0) {
+      if ((direction[g] > 0) ? (position[g] < factorial(groupSize[g]) - 1) : (position[g] > 0))
+        break;
+      direction[g] = -direction[g];
+      g--;
+    }
+    if (g < 0)
+      break;
 
-  SANITY_CHECK(vector);
-}
+    const CFINT* table = transpositions.table[groupSize[g]];
+    int t = (direction[g] > 0) ? table[position[g]] : table[position[g] - 1];
+    position[g] += direction[g];
+
+    swap_adjacent_labels(new_vector, groupOffset[g], groupFirst[g] + t);
 
+    // if the new crossings form a lexicographically smaller
+    // vector than the previously best known, then
+    // save this vector as the new best
+    if (lex_compare(&new_vector[CROSSING_OFFSET], &best_vector[CROSSING_OFFSET], 4 * crossingcount) < 0)
+      memcpy(best_vector, new_vector, vectorBytes);
+  }
 
+  memcpy(vector, best_vector, vectorBytes);
 
+  SANITY_CHECK(vector);
+}
@@ -2,25 +2,98 @@
 #define __BRICKFLAG_H__
 
 #include <iostream>
+#include <stdint.h>
 #include "turan.h"
 
+/* Macros to extract information from brick flags */
+inline int getN(const CFINT* vector)             {
+  return vector[0];
+}
+inline int getK(const CFINT* vector)             {
+  return vector[1];
+}
+inline int getNlabelled(const CFINT* vector)     {
+  return vector[2];
+}
+inline int getKlabelled(const CFINT* vector)     {
+  return vector[3];
+}
+inline int getCrossingCount(const CFINT* vector) {
+  return vector[4];
+}
+inline int getLength(const CFINT* vector)        {
+  return 5 + getCrossingCount(vector) * 4;
+}
+
+#define CROSSING_OFFSET          5
+
+/* Packed crossings. Every endpoint fits in 3 bits, so an edge fits in 6
+   bits and a crossing in 12 bits. A packed brick vector has the same five
+   header entries as a brick vector, followed by one key per crossing;
+   the keys compare like the crossings they encode. */
+#if (MAXN > 8) || (MAXK > 8)
+#error "Packed crossing keys need MAXN <= 8 and MAXK <= 8"
+#endif
+
+// Packs an edge into an integer that compares like the pair (top, bottom)
+inline int packEdge(int top, int bottom) {
+  return (top << 3) | bottom;
+}
+
+// Packs a crossing between two packed edges into an integer that compares
+// like the sorted crossing
+inline int packCrossing(int edge1, int edge2) {
+  return (edge1 < edge2) ? ((edge1 << 6) | edge2) : ((edge2 << 6) | edge1);
+}
+
+// Packs a crossing, keeping the order of its edges
+inline CFINT crossing_key(const CFINT* cr) {
+  return (CFINT) ((packEdge(cr[0], cr[1]) << 6) | packEdge(cr[2], cr[3]));
+}
+
+inline void unpack_crossing_key(CFINT key, CFINT* cr) {
+  cr[0] = (key >> 9) & 7;
+  cr[1] = (key >> 6) & 7;
+  cr[2] = (key >> 3) & 7;
+  cr[3] = key & 7;
+}
+
+inline int getPackedLength(const CFINT* packed)  {
+  return CROSSING_OFFSET + getCrossingCount(packed);
+}
+
 void calc_canonical(CFINT* vector, bool permuteLabelledVertices);
+void calc_canonical_exhaustive(CFINT* vector, bool permuteLabelledVertices);
+int canonical_permutation_count(const CFINT* vector, bool permuteLabelledVertices);
+void swap_adjacent_labels(CFINT* vector, int offset, CFINT label);
+void sort_crossings(CFINT* vector);
 CFINT* copy_vector(const CFINT* vector);
 void free_vector(CFINT* &vector);
 bool vectors_equals(const CFINT* a, const CFINT* b);
 std::size_t vector_hash_value(const CFINT* vector);
 
+void pack_vector(const CFINT* vector, CFINT* packed);
+void unpack_vector(const CFINT* packed, CFINT* vector);
+CFINT* copy_packed_vector(const CFINT* packed);
+void sort_packed_crossings(CFINT* packed);
+bool packed_vectors_equals(const CFINT* a, const CFINT* b);
+std::size_t packed_vector_hash_value(const CFINT* packed);
+uint64_t packed_vector_hash64(const CFINT* packed);
+
 void print_vector(const CFINT* vector);
 void print_vector(const CFINT* vector, std::ostream& stream);
 
 /* Sanity checks */
 #ifdef DEBUG
 #define SANITY_CHECK(vector) { sanity_check(vector, __LINE__, __FILE__); }
+#define SANITY_CHECK_PACKED(packed) { sanity_check_packed(packed, __LINE__, __FILE__); }
 #else
 #define SANITY_CHECK(vector)
+#define SANITY_CHECK_PACKED(packed)
 #endif
 
 void sanity_check(CFINT* vector, int line_no, const std::string fileName);
+void sanity_check_packed(const CFINT* packed, int line_no, const std::string fileName);
 
 
 #endif // __BRICKFLAG_H__
@@ -0,0 +1,144 @@
+#ifndef __CANONKERNEL_H__
+#define __CANONKERNEL_H__
+
+#include <string.h>
+
+#include "turan.h"
+#include "brickvector.h"
+#include "lex_sort.h"
+#include "permutation.h"
+
+// Exchanges the labels 'label' and 'label'+1 on one side of the sorted
+// crossings (offset = 0 for the top vertices, 1 for the bottom vertices)
+// and restores the order of the crossings. Same as swap_adjacent_labels,
+// but with the side and the comparisons fixed at compile time.
+template <int offset> inline void swapAdjacentLabels(CFINT* crossings, int crossingcount, CFINT label) {
+  for (int i = 0; i < crossingcount; i++) {
+    CFINT* cr = &crossings[4 * i];
+    bool touched = false;
+    if ((cr[offset] == label) || (cr[offset] == label + 1)) {
+      cr[offset] = 2 * label + 1 - cr[offset];
+      touched = true;
+    }
+    if ((cr[offset + 2] == label) || (cr[offset + 2] == label + 1)) {
+      cr[offset + 2] = 2 * label + 1 - cr[offset + 2];
+      touched = true;
+    }
+
+    // put the endpoints of the crossing back in order
+    if (touched && (lex_compare<2>(&cr[0], &cr[2]) > 0)) {
+      CFINT t0 = cr[0], t1 = cr[1];
+      cr[0] = cr[2];
+      cr[1] = cr[3];
+      cr[2] = t0;
+      cr[3] = t1;
+    }
+  }
+
+  for (int i = 1; i < crossingcount; i++) {
+    CFINT cr[4];
+    memcpy(cr, &crossings[4 * i], sizeof(CFINT) * 4);
+    int j = i;
+    while ((j > 0) && (lex_compare<4>(&crossings[4 * (j - 1)], cr) > 0)) {
+      memcpy(&crossings[4 * j], &crossings[4 * (j - 1)], sizeof(CFINT) * 4);
+      j--;
+    }
+    if (j != i)
+      memcpy(&crossings[4 * j], cr, sizeof(CFINT) * 4);
+  }
+}
+
+// Exhaustive canonical form for configurations with N top and K bottom
+// vertices. This is calc_canonical_exhaustive with the shape fixed at
+// compile time: the buffers have a fixed size (no two crossings involve
+// the same pair of edges, so there are at most N(N-1)K(K-1)/2 of them)
+// and the crossing comparisons are unrolled.
+template <int N, int K> struct CanonicalKernel {
+  // (shapes without crossings still get room for one, so that the
+  // crossing loops do not index an array of length zero)
+  enum { MAXCROSSINGS = N * (N - 1) * K * (K - 1) / 2,
+         MAXLENGTH = CROSSING_OFFSET + 4 * (MAXCROSSINGS > 0 ? MAXCROSSINGS : 1)
+       };
+
+  static void exhaustive(CFINT* vector, bool permuteLabelledVertices, const CFINT (*transpositions)[Factorial<MAXNK>::value]) {
+    assert((getN(vector) == N) && (getK(vector) == K));
+    assert(getCrossingCount(vector) <= MAXCROSSINGS);
+
+    int Nlabelled = getNlabelled(vector),
+        Klabelled = getKlabelled(vector),
+        crossingcount = getCrossingCount(vector);
+
+    CFINT new_vector[MAXLENGTH], best_vector[MAXLENGTH];
+    int vectorBytes = sizeof(CFINT) * getLength(vector);
+
+    memcpy(new_vector, vector, vectorBytes);
+    sort_crossings(new_vector);
+    memcpy(best_vector, new_vector, vectorBytes);
+
+    CFINT* crossings = &new_vector[CROSSING_OFFSET];
+    CFINT* best_crossings = &best_vector[CROSSING_OFFSET];
+
+    // groups of vertices whose labels are permuted, as in
+    // calc_canonical_exhaustive
+    int groupOffset[4], groupFirst[4], groupSize[4], groupPermutations[4];
+    int groupCount = 0;
+    const int offsets[4] = { 0, 0, 1, 1 };
+    const int firsts[4]  = { 0, Nlabelled, 0, Klabelled };
+    const int sizes[4]   = { permuteLabelledVertices ? Nlabelled : 0, N - Nlabelled,
+                             permuteLabelledVertices ? Klabelled : 0, K - Klabelled
+                           };
+    for (int g = 0; g < 4; g++) {
+      if (sizes[g] <= 1)
+        continue;
+      groupOffset[groupCount] = offsets[g];
+      groupFirst[groupCount]  = firsts[g];
+      groupSize[groupCount]   = sizes[g];
+      groupPermutations[groupCount] = factorial(sizes[g]);
+      groupCount++;
+    }
+
+    int position[4], direction[4];
+    for (int g = 0; g < groupCount; g++) {
+      position[g] = 0;
+      direction[g] = 1;
+    }
+
+    while (true) {
+      int g = groupCount - 1;
+      while (g >= 0) {
+        if ((direction[g] > 0) ? (position[g] < groupPermutations[g] - 1) : (position[g] > 0))
+          break;
+        direction[g] = -direction[g];
+        g--;
+      }
+      if (g < 0)
+        break;
+
+      const CFINT* table = transpositions[groupSize[g]];
+      int t = (direction[g] > 0) ? table[position[g]] : table[position[g] - 1];
+      position[g] += direction[g];
+
+      if (groupOffset[g] == 0)
+        swapAdjacentLabels<0>(crossings, crossingcount, groupFirst[g] + t);
+      else
+        swapAdjacentLabels<1>(crossings, crossingcount, groupFirst[g] + t);
+
+      // compare crossing by crossing; the first crossing that differs
+      // decides
+      for (int i = 0; i < crossingcount; i++) {
+        int c = lex_compare<4>(&crossings[4 * i], &best_crossings[4 * i]);
+        if (c < 0) {
+          memcpy(&best_crossings[4 * i], &crossings[4 * i], sizeof(CFINT) * 4 * (crossingcount - i));
+          break;
+        }
+        if (c > 0)
+          break;
+      }
+    }
+
+    memcpy(vector, best_vector, vectorBytes);
+    SANITY_CHECK(vector);
+  }
+};
+
+#endif // __CANONKERNEL_H__
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <climits>
+#include <string.h>
+
+#include "canonsearch.h"
+#include "brickvector.h"
+#include "lex_sort.h"
+#include "relabel.h"
+
+#define TOP              0
+#define BOTTOM           1
+
+/* Partition refinement */
+
+// A crossing gives each of its four endpoints one incidence, and a
+// configuration has at most one crossing per pair of edges that can cross
+// (CROSSINGSET_PAIRS in crossingset.h)
+#define MAXINCIDENCES    (MAXN * (MAXN - 1) / 2 * MAXK * (MAXK - 1))
+
+struct SignatureOrder {
+  const int* cell;
+  const int (*signature)[MAXINCIDENCES];
+  const int* signatureLength;
+
+  bool operator() (int v, int w) const {
+    if (cell[v] != cell[w])
+      return cell[v] < cell[w];
+    return std::lexicographical_compare(signature[v], signature[v] + signatureLength[v],
+                                        signature[w], signature[w] + signatureLength[w]);
+  }
+};
+
+inline int encodeIncidence(int partnerCell, int otherTopCell, int otherBottomCell) {
+  return (partnerCell * (MAXN + MAXK) + otherTopCell) * (MAXN + MAXK) + otherBottomCell;
+}
+
+int refine_partition(const CFINT* vector, int* cell, int cellCount) {
+  int N = getN(vector), K = getK(vector), V = N + K;
+  int crossingcount = getCrossingCount(vector);
+  const CFINT* crossings = &vector[CROSSING_OFFSET];
+
+  if (crossingcount > MAXINCIDENCES)
+    fatal_error("Cannot refine the partition of a configuration with more crossings than pairs of edges.");
+
+  int signature[MAXN + MAXK][MAXINCIDENCES];
+  int signatureLength[MAXN + MAXK];
+
+  while (true) {
+    // for every vertex, collect the cells of the other three endpoints
+    // of each crossing it is involved in
+    for (int v = 0; v < V; v++)
+      signatureLength[v] = 0;
+    for (int i = 0; i < crossingcount; i++) {
+      const CFINT* cr = &crossings[4 * i];
+      int a = cr[0], b = N + cr[1], c = cr[2], d = N + cr[3];
+      signature[a][signatureLength[a]++] = encodeIncidence(cell[b], cell[c], cell[d]);
+      signature[b][signatureLength[b]++] = encodeIncidence(cell[a], cell[c], cell[d]);
+      signature[c][signatureLength[c]++] = encodeIncidence(cell[d], cell[a], cell[b]);
+      signature[d][signatureLength[d]++] = encodeIncidence(cell[c], cell[a], cell[b]);
+    }
+    for (int v = 0; v < V; v++)
+      std::sort(signature[v], signature[v] + signatureLength[v]);
+
+    // split the cells according to the signatures
+    int order[MAXN + MAXK];
+    for (int v = 0; v < V; v++)
+      order[v] = v;
+    // (an insertion sort, as there are at most MAXN + MAXK vertices)
+    SignatureOrder compare = { cell, signature, signatureLength };
+    for (int i = 1; i < V; i++) {
+      int v = order[i], j = i;
+      for (; (j > 0) && compare(v, order[j - 1]); j--)
+        order[j] = order[j - 1];
+      order[j] = v;
+    }
+
+    int newCell[MAXN + MAXK];
+    int newCellCount = 0;
+    for (int i = 0; i < V; i++) {
+      if ((i > 0) && compare(order[i-1], order[i]))
+        newCellCount++;
+      newCell[order[i]] = newCellCount;
+    }
+    newCellCount++;
+
+    memcpy(cell, newCell, sizeof(int) * V);
+    if (newCellCount == cellCount)
+      return cellCount;
+    cellCount = newCellCount;
+  }
+}
+
+/* Search tree */
+
+struct CanonicalSearch {
+  CFINT* vector;
+  int N, K, Nlabelled, Klabelled, crossingcount;
+  bool permuteLabelledVertices;
+
+  // order in which the new indices are handed out
+  int levelCount;
+  int levelSide[MAXN + MAXK];
+  int levelIndex[MAXN + MAXK];
+
+  // image[side][v] is the new index of vertex v, or -1 if v has not
+  // been assigned a new index yet; the new indices 0, ..., assigned[side]-1
+  // have been handed out
+  CFINT image[2][MAXNK];
+  int assigned[2];
+
+  // crossings of the vector as packed keys, the crossings under the
+  // current labelling, and the best crossings found so far together with
+  // the labelling that produced them
+  CFINT* keys;
+  CFINT* newKeys;
+  bool haveBest;
+  CFINT* bestKeys;
+  CFINT bestPreimage[2][MAXNK];
+
+  // cells of the refined vertex partition
+  int cell[MAXN + MAXK];
+  bool trivialGroup;
+
+  // automorphisms found so far
+  int generatorCount;
+  CFINT generators[MAXGENERATORS][2][MAXNK];
+};
+
+// Determines the vertices that may receive new index 'index' on the given side
+inline void candidateRange(const CanonicalSearch& s, int side, int index, int& first, int& last) {
+  int count     = (side == TOP) ? s.N : s.K;
+  int labelled  = (side == TOP) ? s.Nlabelled : s.Klabelled;
+
+  if (index >= labelled) {
+    first = labelled;
+    last  = count;
+  } else if (s.permuteLabelledVertices) {
+    first = 0;
+    last  = labelled;
+  } else {
+    first = index;
+    last  = index + 1;
+  }
+}
+
+inline int cellOf(const CanonicalSearch& s, int side, int v) {
+  return s.cell[(side == TOP) ? v : s.N + v];
+}
+
+inline int findRoot(int* parent, int v) {
+  while (parent[v] != v)
+    v = parent[v] = parent[parent[v]];
+  return v;
+}
+
+// Checks whether the subtree in which vertex v receives the next index
+// is the image of an already explored subtree under an automorphism
+// that fixes all vertices that have been assigned an index.
+bool equivalentToExplored(const CanonicalSearch& s, int side, int v, const CFINT* explored, int exploredCount) {
+  if (s.trivialGroup || (s.generatorCount == 0))
+    return false;
+
+  // automorphisms never map vertices between different cells
+  bool sameCell = false;
+  for (int i = 0; i < exploredCount; i++)
+    if (cellOf(s, side, explored[i]) == cellOf(s, side, v))
+      sameCell = true;
+  if (!sameCell)
+    return false;
+
+  // compute the orbits of the generators that fix the assigned vertices
+  int count = (side == TOP) ? s.N : s.K;
+  int parent[MAXNK];
+  for (int u = 0; u < count; u++)
+    parent[u] = u;
+
+  for (int g = 0; g < s.generatorCount; g++) {
+    const CFINT (*generator)[MAXNK] = s.generators[g];
+
+    bool fixesAssigned = true;
+    for (int u = 0; (u < s.N) && fixesAssigned; u++)
+      if ((s.image[TOP][u] >= 0) && (generator[TOP][u] != u))
+        fixesAssigned = false;
+    for (int u = 0; (u < s.K) && fixesAssigned; u++)
+      if ((s.image[BOTTOM][u] >= 0) && (generator[BOTTOM][u] != u))
+        fixesAssigned = false;
+    if (!fixesAssigned)
+      continue;
+
+    for (int u = 0; u < count; u++) {
+      int r1 = findRoot(parent, u), r2 = findRoot(parent, generator[side][u]);
+      if (r1 != r2)
+        parent[r1] = r2;
+    }
+  }
+
+  int root = findRoot(parent, v);
+  for (int i = 0; i < exploredCount; i++)
+    if (findRoot(parent, explored[i]) == root)
+      return true;
+  return false;
+}
+
+// Evaluates a complete labelling. Returns the level the search should
+// return to: if the labelling gives the same vector as the best labelling,
+// the subtree in which the two labellings first differ is the image of an
+// explored subtree under the automorphism that relates them, and the
+// search returns to the node where they part ways.
+int searchLeaf(CanonicalSearch& s) {
+  relabel_crossing_keys(s.keys, s.newKeys, s.crossingcount, s.image[TOP], s.image[BOTTOM]);
+  for (int i = 0; i < s.crossingcount; i++)
+    s.newKeys[i] = (CFINT) packCrossing(s.newKeys[i] >> 6, s.newKeys[i] & 63);
+  sort_crossing_keys(s.newKeys, s.crossingcount);
+
+  int cmp = -1;
+  if (s.haveBest) {
+    int i = 0;
+    while ((i < s.crossingcount) && (s.newKeys[i] == s.bestKeys[i]))
+      i++;
+    cmp = (i == s.crossingcount) ? 0 : ((s.newKeys[i] < s.bestKeys[i]) ? -1 : 1);
+  }
+
+  if (cmp < 0) {
+    memcpy(s.bestKeys, s.newKeys, sizeof(CFINT) * s.crossingcount);
+    for (int v = 0; v < s.N; v++)
+      s.bestPreimage[TOP][s.image[TOP][v]] = v;
+    for (int v = 0; v < s.K; v++)
+      s.bestPreimage[BOTTOM][s.image[BOTTOM][v]] = v;
+    s.haveBest = true;
+  } else if ((cmp == 0) && !s.trivialGroup) {
+    if (s.generatorCount == MAXGENERATORS)
+      fatal_error("Too many automorphisms found in canonical search; increase MAXGENERATORS.");
+
+    // both labellings give the same vector, so combining the one with
+    // the inverse of the other gives an automorphism
+    CFINT (*generator)[MAXNK] = s.generators[s.generatorCount++];
+    for (int v = 0; v < s.N; v++)
+      generator[TOP][v] = s.bestPreimage[TOP][s.image[TOP][v]];
+    for (int v = 0; v < s.K; v++)
+      generator[BOTTOM][v] = s.bestPreimage[BOTTOM][s.image[BOTTOM][v]];
+
+    for (int level = 0; level < s.levelCount; level++) {
+      int side = s.levelSide[level], index = s.levelIndex[level];
+      if (s.image[side][s.bestPreimage[side][index]] != index)
+        return level;
+    }
+  }
+  return s.levelCount;
+}
+
+// Checks whether every labelling that extends the current partial labelling
+// gives a vector that is lexicographically larger than the best vector found
+// so far. Unassigned vertices will receive an index that is at least the
+// next index to be handed out on their side, which gives a lower bound for
+// each crossing that has an unassigned endpoint. The crossings that are known
+// exactly and lie below all of these lower bounds form a prefix of the
+// resulting vector, and the smallest lower bound bounds the crossing after it.
+bool prefixWorseThanBest(const CanonicalSearch& s) {
+  int keys[s.crossingcount];
+  int keyCount = 0;
+  int lowerBound = INT_MAX;
+
+  const CFINT* cr = &s.vector[CROSSING_OFFSET];
+  for (int i = 0; i < s.crossingcount; i++, cr += 4) {
+    int a = s.image[TOP][cr[0]], b = s.image[BOTTOM][cr[1]];
+    int c = s.image[TOP][cr[2]], d = s.image[BOTTOM][cr[3]];
+    if ((a >= 0) && (b >= 0) && (c >= 0) && (d >= 0)) {
+      keys[keyCount++] = packCrossing(packEdge(a, b), packEdge(c, d));
+      continue;
+    }
+
+    // the two top (bottom) endpoints of a crossing are distinct, so if
+    // both are unassigned, one of them receives at least the next index + 1
+    int a1 = a, a2 = a, c1 = c, c2 = c;
+    if ((a < 0) && (c < 0)) {
+      a1 = c2 = s.assigned[TOP];
+      a2 = c1 = s.assigned[TOP] + 1;
+    } else {
+      if (a < 0) a1 = a2 = s.assigned[TOP];
+      if (c < 0) c1 = c2 = s.assigned[TOP];
+    }
+    int b1 = b, b2 = b, d1 = d, d2 = d;
+    if ((b < 0) && (d < 0)) {
+      b1 = d2 = s.assigned[BOTTOM];
+      b2 = d1 = s.assigned[BOTTOM] + 1;
+    } else {
+      if (b < 0) b1 = b2 = s.assigned[BOTTOM];
+      if (d < 0) d1 = d2 = s.assigned[BOTTOM];
+    }
+    lowerBound = std::min(lowerBound, packCrossing(packEdge(a1, b1), packEdge(c1, d1)));
+    lowerBound = std::min(lowerBound, packCrossing(packEdge(a1, b2), packEdge(c1, d2)));
+    lowerBound = std::min(lowerBound, packCrossing(packEdge(a2, b1), packEdge(c2, d1)));
+    lowerBound = std::min(lowerBound, packCrossing(packEdge(a2, b2), packEdge(c2, d2)));
+  }
+  std::sort(keys, keys + keyCount);
+
+  int i = 0;
+  for (; (i < keyCount) && (keys[i] < lowerBound); i++)
+    if (keys[i] != s.bestKeys[i])
+      return keys[i] > s.bestKeys[i];
+
+  if (i == s.crossingcount)
+    return false;
+  return lowerBound > s.bestKeys[i];
+}
+
+// Explores the subtree below the current partial labelling, in which the
+// indices for levels 0, ..., level-1 have been handed out. Returns the
+// level the search should return to (see searchLeaf).
+int searchNode(CanonicalSearch& s, int level) {
+  if (level == s.levelCount)
+    return searchLeaf(s);
+
+  int side = s.levelSide[level], index = s.levelIndex[level];
+  int first, last;
+  candidateRange(s, side, index, first, last);
+
+  CFINT explored[MAXNK];
+  int exploredCount = 0;
+
+  for (int v = first; v < last; v++) {
+    if (s.image[side][v] >= 0)
+      continue;
+    if (equivalentToExplored(s, side, v, explored, exploredCount))
+      continue;
+
+    s.image[side][v] = index;
+    s.assigned[side]++;
+    int backtrackLevel = s.levelCount;
+    if (!s.haveBest || !prefixWorseThanBest(s))
+      backtrackLevel = searchNode(s, level + 1);
+    s.assigned[side]--;
+    s.image[side][v] = -1;
+
+    if (backtrackLevel < level)
+      return backtrackLevel;
+
+    explored[exploredCount++] = v;
+  }
+  return s.levelCount;
+}
+
+// Sets up the initial partition according to the labelled vertices
+int initialPartition(const CanonicalSearch& s, int* cell) {
+  int cellCount = 0;
+  for (int side = TOP; side <= BOTTOM; side++) {
+    int count    = (side == TOP) ? s.N : s.K;
+    int labelled = (side == TOP) ? s.Nlabelled : s.Klabelled;
+    int offset   = (side == TOP) ? 0 : s.N;
+
+    for (int v = 0; v < labelled; v++)
+      cell[offset + v] = s.permuteLabelledVertices ? cellCount : cellCount + v;
+    if (labelled > 0)
+      cellCount += s.permuteLabelledVertices ? 1 : labelled;
+
+    for (int v = labelled; v < count; v++)
+      cell[offset + v] = cellCount;
+    if (labelled < count)
+      cellCount++;
+  }
+  return cellCount;
+}
+
+void search_canonical(CFINT* vector, bool permuteLabelledVertices) {
+  search_canonical(vector, permuteLabelledVertices, NULL);
+}
+
+void search_canonical(CFINT* vector, bool permuteLabelledVertices, CanonicalLabelling* labelling) {
+  SANITY_CHECK(vector);
+
+  CanonicalSearch s;
+  s.vector        = vector;
+  s.N             = getN(vector);
+  s.K             = getK(vector);
+  s.Nlabelled     = getNlabelled(vector);
+  s.Klabelled     = getKlabelled(vector);
+  s.crossingcount = getCrossingCount(vector);
+  s.permuteLabelledVertices = permuteLabelledVertices;
+
+  // if there is only one permutation to try, sorting is all that is needed
+  if (canonical_permutation_count(vector, permuteLabelledVertices) == 1) {
+    sort_crossings(vector);
+    if (labelling != NULL) {
+      for (int v = 0; v < s.N; v++)
+        labelling->labelN[v] = v;
+      for (int v = 0; v < s.K; v++)
+        labelling->labelK[v] = v;
+      labelling->generatorCount = 0;
+    }
+    return;
+  }
+
+  // hand out new indices alternately on the top and bottom side
+  s.levelCount = 0;
+  for (int index = 0; (index < s.N) || (index < s.K); index++) {
+    if (index < s.N) {
+      s.levelSide[s.levelCount] = TOP;
+      s.levelIndex[s.levelCount++] = index;
+    }
+    if (index < s.K) {
+      s.levelSide[s.levelCount] = BOTTOM;
+      s.levelIndex[s.levelCount++] = index;
+    }
+  }
+
+  // if the refined partition is discrete, the only automorphism is the identity
+  int cellCount = initialPartition(s, s.cell);
+  cellCount = refine_partition(vector, s.cell, cellCount);
+  s.trivialGroup = (cellCount == s.N + s.K);
+  s.generatorCount = 0;
+
+  for (int v = 0; v < s.N; v++)
+    s.image[TOP][v] = -1;
+  for (int v = 0; v < s.K; v++)
+    s.image[BOTTOM][v] = -1;
+  s.assigned[TOP] = s.assigned[BOTTOM] = 0;
+
+  CFINT keys[s.crossingcount], newKeys[s.crossingcount], bestKeys[s.crossingcount];
+  for (int i = 0; i < s.crossingcount; i++)
+    keys[i] = crossing_key(&vector[CROSSING_OFFSET + 4 * i]);
+  s.keys     = keys;
+  s.newKeys  = newKeys;
+  s.bestKeys = bestKeys;
+  s.haveBest = false;
+
+  searchNode(s, 0);
+
+  for (int i = 0; i < s.crossingcount; i++)
+    unpack_crossing_key(bestKeys[i], &vector[CROSSING_OFFSET + 4 * i]);
+
+  if (labelling != NULL) {
+    for (int index = 0; index < s.N; index++)
+      labelling->labelN[s.bestPreimage[TOP][index]] = index;
+    for (int index = 0; index < s.K; index++)
+      labelling->labelK[s.bestPreimage[BOTTOM][index]] = index;
+
+    labelling->generatorCount = s.generatorCount;
+    for (int g = 0; g < s.generatorCount; g++) {
+      memcpy(labelling->generatorN[g], s.generators[g][TOP], sizeof(CFINT) * s.N);
+      memcpy(labelling->generatorK[g], s.generators[g][BOTTOM], sizeof(CFINT) * s.K);
+    }
+  }
+
+  SANITY_CHECK(vector);
+}
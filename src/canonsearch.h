@@ -0,0 +1,55 @@
+#ifndef __CANONSEARCH_H__
+#define __CANONSEARCH_H__
+
+#include "turan.h"
+
+#define MAXGENERATORS    64
+
+// The labelling that puts a configuration in canonical form, and the
+// automorphism group of the configuration. labelN[v] (labelK[v]) is the
+// new index of top (bottom) vertex v; relabelling the vertices this way
+// and sorting the crossings gives the canonical form. The automorphisms
+// are the permutations of the vertices that map the configuration onto
+// itself (and respect the labelled vertices); the group is generated by
+// generatorN[g], generatorK[g] for g < generatorCount, each mapping
+// vertices to vertices. There are no generators if the group is trivial.
+struct CanonicalLabelling {
+  CFINT labelN[MAXN];
+  CFINT labelK[MAXK];
+
+  int generatorCount;
+  CFINT generatorN[MAXGENERATORS][MAXN];
+  CFINT generatorK[MAXGENERATORS][MAXK];
+};
+
+// Puts a brick vector in canonical form, i.e. replaces it by the
+// lexicographically smallest vector that can be obtained by permuting
+// its unlabelled vertices (and, if permuteLabelledVertices is set, its
+// labelled vertices among themselves). The result is identical to that
+// of calc_canonical_exhaustive.
+//
+// Instead of trying all permutations, the labelling is built one vertex
+// at a time in a search tree. Automorphisms of the configuration that
+// are discovered along the way are used to skip subtrees that are
+// images of subtrees that have already been explored, and a partition of
+// the vertices that is refined using crossing incidences tells whether
+// there can be any automorphisms at all. A subtree is cut as soon as the
+// smallest vector it could produce is larger than the best vector found
+// so far.
+void search_canonical(CFINT* vector, bool permuteLabelledVertices);
+
+// Same as above, but also computes the canonical labelling and the
+// automorphism group (if labelling is not NULL)
+void search_canonical(CFINT* vector, bool permuteLabelledVertices, CanonicalLabelling* labelling);
+
+// Refines a partition of the vertices of a brick vector until it is
+// equitable with respect to crossing incidences. The vertices are
+// numbered 0, ..., N-1 for the top vertices and N, ..., N+K-1 for the
+// bottom vertices; cell[v] is the cell of vertex v. Cells are numbered
+// 0, ..., cellCount-1 and the numbering only depends on the structure
+// of the configuration, so that any automorphism that respects the
+// initial partition maps each cell onto itself. Returns the new number
+// of cells.
+int refine_partition(const CFINT* vector, int* cell, int cellCount);
+
+#endif // __CANONSEARCH_H__
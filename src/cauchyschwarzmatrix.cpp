@@ -1,52 +1,31 @@
 #include <vector>
 #include <fstream>
-#include <bitset>
+#include <algorithm>
 
 #include "cauchyschwarzmatrix.h"
 #include "permutation.h"
 #include "lex_sort.h"
+#include "threads.h"
 
 #include "mexCSmatrixCode.h"
 #include "mexCSinequalityCode.h"
 
 using namespace std;
 
-struct SubFlag {
-  Configuration config;
-  std::bitset<MAXN> unlabelledN;
-  std::bitset<MAXK> unlabelledK;
+// The flags of a batch of the variable flag algebra are handed out to the
+// threads one at a time
+struct ConstructionBatch {
+  CauchySchwarzMatrix* matrix;
+  int first, count;
+  std::vector<CauchySchwarzMatrix::FlagTerms>* flagTerms;
+  int next;
 };
 
 CauchySchwarzMatrix::CauchySchwarzMatrix(const BrickAlgebra& variableAlgebra) {
   this->subFlagAlgebra = NULL;
-  this->matrix = NULL;
   this->variableAlgebra = &variableAlgebra;
 }
 
-CauchySchwarzMatrix::~CauchySchwarzMatrix() {
-  if (this->matrix != NULL) {
-    int n = this->subFlagAlgebra->size();
-    for (int i = 0; i < n; i++) {
-      for (int j = 0; j < n; j++)
-        if (matrix[i][j] != NULL) delete matrix[i][j];
-      delete[] matrix[i];
-    }
-    delete[] matrix;
-  }
-  if (this->subFlagAlgebra != NULL)
-    delete this->subFlagAlgebra;
-}
-
-void CauchySchwarzMatrix::allocateMatrix() {
-  int n = this->subFlagAlgebra->size();
-  this->matrix = new boost::unordered_map<int, int>** [n];
-  for (int i = 0; i < n; i++) {
-    this->matrix[i] = new boost::unordered_map<int, int>*[n];
-    for (int j = 0; j < n; j++)
-      this->matrix[i][j] = NULL;
-  }
-}
-
 #define print_array(array, len) _print_array(#array, array, len);
 
 void _print_array(std::string name, CFINT* array, int len) {
@@ -84,19 +63,19 @@ void CauchySchwarzMatrix::construct(int subN, int subK, int subNlabelled, int su
   if (2 * subK - subKlabelled > K)
     fatal_error("The total number of bottom vertices in the product exceeds the number of bottom vertices of the variables.");
 
-  int disjointChoices = binomial(N - subNlabelled, subNunlabelled)
-                        * binomial(N - subNlabelled - subNunlabelled, subNunlabelled)
-                        * binomial(K - subKlabelled, subKunlabelled)
-                        * binomial(K - subKlabelled - subKunlabelled, subKunlabelled);
+  disjointChoices = binomial(N - subNlabelled, subNunlabelled)
+                    * binomial(N - subNlabelled - subNunlabelled, subNunlabelled)
+                    * binomial(K - subKlabelled, subKunlabelled)
+                    * binomial(K - subKlabelled - subKunlabelled, subKunlabelled);
   // denominator for probabilities; notice that this denominator is actually
   // irrelevant because the C-S matrix may be scaled by any positive number
   _denominator = disjointChoices * binomial(N, subNlabelled) * binomial(K, subKlabelled) *
                  factorial(subNlabelled) * factorial(subKlabelled);
 
-  subFlagAlgebra = new BrickAlgebra(subN, subK, subNlabelled, subKlabelled);
-  subFlagAlgebra->constructElements();
-
-  allocateMatrix();
+  restrictions = &RestrictionTable::shared(N, K, subN, subK, subNlabelled, subKlabelled);
+  assert(restrictions->getAlgebra().size() == variableAlgebra->size());
+  subFlagAlgebra = &restrictions->getSubFlagAlgebra();
+  buildPairSchedule();
 
 
   /* Now, for every variable flag F, we go through all combinations of:
@@ -111,10 +90,14 @@ void CauchySchwarzMatrix::construct(int subN, int subK, int subNlabelled, int su
      the vertices in labelN and labelK, and deleting all other vertices
      except the ones in unlabelledN1 and unlabelledK1. We construct
      F2 similarly. Next, we add the term (1/denominator)*F in the matrix
-     entries corresponding to (F1, F2) and (F2, F1).                    */
+     entries corresponding to (F1, F2) and (F2, F1). Only the first of
+     these is stored (see addTerm).
+
+     The flags F1 and F2 are looked up in the restriction table of the
+     shape of the matrix, which has them for every labelling and every
+     choice of unlabelled vertices.                                      */
 
-  const std::vector<Configuration> & flagList = variableAlgebra->getFlagList();
-  std::vector<Configuration>::const_iterator flagIterator;
+  const FlagStore& flagList = variableAlgebra->getFlagList();
 
 
 #if VERBOSITY >= 2
@@ -122,138 +105,103 @@ void CauchySchwarzMatrix::construct(int subN, int subK, int subNlabelled, int su
             << subNlabelled << "," << subKlabelled << ") ..." << std::flush;
 #endif
 
-  // construct sets seqN = {0, ..., N-1} and seqK = {0, ..., K-1}
-
-  CFINT seqN[N];
-  for (int i = 0; i < N; i++) seqN[i] = i;
-  CFINT seqK[K];
-  for (int i = 0; i < K; i++) seqK[i] = i;
-
-  int flagCount = 0;
-  for (flagIterator = flagList.begin(); flagIterator < flagList.end(); ++flagIterator) {
-    // generate all ordered subsets labelN of seqN = {0, ..., N-1}
-    CFINT labelN[subNlabelled];
-    subsetBuffer<CFINT> bufferN(seqN, N, subNlabelled);
-
-    while (nextOrderedSubset(labelN, bufferN)) {
-      // generate all subsets labelK of seqK = {0, ..., K-1}
-      CFINT labelK[subKlabelled];
-      subsetBuffer<CFINT> bufferK(seqK, K, subKlabelled);
-      while (nextOrderedSubset(labelK, bufferK)) {
-        // construct vector of flags found of this type
-        std::vector<SubFlag> subFlags;
-
-        // put labelled vertices into bitsets
-        std::bitset<MAXN> setLabelN;
-        for (int i = 0; i < subNlabelled; i++) setLabelN.set(labelN[i]);
-        std::bitset<MAXN> setLabelK;
-        for (int i = 0; i < subKlabelled; i++) setLabelK.set(labelK[i]);
-
-        // construct arrays of unlabelled vertices
-        CFINT remainingN[N], remainingK[K];
-        for (int i = 0, t = 0; i < N; i++)
-          if (!setLabelN.test(i))
-            remainingN[t++] = i;
-        for (int i = 0, t = 0; i < K; i++)
-          if (!setLabelK.test(i))
-            remainingK[t++] = i;
-
-        // generate all disjoint subsets of unlabelled N vertices
-        CFINT unlabelledN[N];
-        subsetBuffer<CFINT> bufferN1(remainingN, N - subNlabelled, subNunlabelled);
-
-        while (nextSubset(unlabelledN, bufferN1)) {
-          // generate all disjoint subsets of unlabelled K vertices
-          CFINT unlabelledK[K];
-          subsetBuffer<CFINT> bufferK1(remainingK, K - subKlabelled, subKunlabelled);
-          while (nextSubset(unlabelledK, bufferK1)) {
-            // we now have marked exactly which vertices are to be labelled,
-            // and which unlabelled vertices go to which flag F1, F2.
-
-            CFINT newIndexN[N], newIndexK[K];
-
-            for (int i = 0; i < N; i++) newIndexN[i] = -1;
-            for (int i = 0; i < K; i++) newIndexK[i] = -1;
-
-            int iN = 0, iK = 0;
-            for (int i = 0; i < subNlabelled; i++)
-              newIndexN[labelN[i]] = iN++;
-            for (int i = 0; i < subNunlabelled; i++)
-              newIndexN[unlabelledN[i]] = iN++;
-            for (int i = 0; i < N; i++)
-              if (newIndexN[i] == -1)
-                newIndexN[i] = iN++;
-
-            for (int i = 0; i < subKlabelled; i++)
-              newIndexK[labelK[i]] = iK++;
-            for (int i = 0; i < subKunlabelled; i++)
-              newIndexK[unlabelledK[i]] = iK++;
-            for (int i = 0; i < K; i++)
-              if (newIndexK[i] == -1)
-                newIndexK[i] = iK++;
-
-            // construct subflag
-            SubFlag SF;
-            SF.config = *flagIterator;
-            SF.config.reindexN(newIndexN);
-            SF.config.reindexK(newIndexK);
-            SF.config.keepNvertices(subN);
-            SF.config.keepKvertices(subK);
-            SF.config.setNlabelled(subNlabelled);
-            SF.config.setKlabelled(subKlabelled);
-            SF.config.putInCanonicalForm(false);
-
-            for (int i = 0; i < subNunlabelled; i++)
-              SF.unlabelledN.set(unlabelledN[i]);
-            for (int i = 0; i < subKunlabelled; i++)
-              SF.unlabelledK.set(unlabelledK[i]);
-
-            subFlags.push_back(SF);
-          };
-        };
-
-        int subFlagPairCount = 0;
-        // now go through all pairs of disjoint subflags
-        for (int i = 0; i < subFlags.size(); i++)
-          for (int j = i; j < subFlags.size(); j++) { // need i instead of i+1 b/c there might be no unlabelled vertices
-            // calculate intersection of sets of unlabelled vertices and make
-            // sure they are empty.
-            std::bitset<MAXN> capN = subFlags[i].unlabelledN & subFlags[j].unlabelledN;
-            if (capN.count() != 0) continue;
-            std::bitset<MAXK> capK = subFlags[i].unlabelledK & subFlags[j].unlabelledK;
-            if (capK.count() != 0) continue;
-
-            // now add 1/denominator * F to entry F1, F2 in the matrix
-            subFlagPairCount++;
-            addTerm(subFlags[i].config, subFlags[j].config, *flagIterator, 1);
-            if (i != j) {
-              addTerm(subFlags[j].config, subFlags[i].config, *flagIterator, 1);
-              subFlagPairCount++;
-            }
-          }
-
-        assert(subFlagPairCount == disjointChoices);
-      }
-    }
-    flagCount++;
+  int threadCount = get_thread_count();
+  int flagCount = flagList.size();
+
+  flagStart.assign(1, 0);
+  flagEntries.clear();
+  flagFactors.clear();
+
+  std::vector<FlagTerms> flagTerms(CSMATRIX_BATCH_SIZE);
+  for (int first = 0; first < flagCount; first += CSMATRIX_BATCH_SIZE) {
+    int count = std::min<int>(CSMATRIX_BATCH_SIZE, flagCount - first);
+
+    /* Collect the terms of the flags of the batch on all threads, and
+       append them in the order of the flags, so that the matrix is the
+       same for any number of threads. */
+    ConstructionBatch batch = { this, first, count, &flagTerms, 0 };
+    run_parallel(collectTerms, &batch, std::min<int>(threadCount, count));
+
+    for (int f = 0; f < count; f++) {
+      flagEntries.insert(flagEntries.end(), flagTerms[f].entries.begin(), flagTerms[f].entries.end());
+      flagFactors.insert(flagFactors.end(), flagTerms[f].factors.begin(), flagTerms[f].factors.end());
+      flagStart.push_back(flagEntries.size());
+
 #if VERBOSITY >= 2
-    if ((flagCount % 100) == 0) std::cout << "." << std::flush;
+      if (((first + f + 1) % 100) == 0) std::cout << "." << std::flush;
 #endif
-
+    }
   }
 
+  freeze();
+
 #if VERBOSITY >= 2
-  std::cout << " Done." << std::endl;
+  std::cout << " Done";
+  if (threadCount > 1)
+    std::cout << " (" << threadCount << " threads)";
+  std::cout << "." << std::endl;
 #endif
 
 }
 
 
-void CauchySchwarzMatrix::addTerm(const Configuration& F1, const Configuration& F2, const Configuration& F, const int factor) {
-  int F1index = subFlagAlgebra->getIndex(F1);
-  int F2index = subFlagAlgebra->getIndex(F2);
-  int Findex = variableAlgebra->getIndex(F);
+void CauchySchwarzMatrix::buildPairSchedule() {
+  int slotCount = restrictions->slots();
 
+  // need s <= t instead of s < t b/c there might be no unlabelled vertices
+  pairSchedule.clear();
+  int subFlagPairCount = 0;
+  for (int s = 0; s < slotCount; s++)
+    for (int t = s; t < slotCount; t++)
+      if (((restrictions->unlabelledN(s) & restrictions->unlabelledN(t)) == 0)
+          && ((restrictions->unlabelledK(s) & restrictions->unlabelledK(t)) == 0)) {
+        pairSchedule.push_back(make_pair(s, t));
+        subFlagPairCount += (s == t) ? 1 : 2;
+      }
+
+  assert(subFlagPairCount == disjointChoices);
+}
+
+void CauchySchwarzMatrix::collectTerms(void* argument, int, int) {
+  ConstructionBatch* batch = (ConstructionBatch*) argument;
+
+  // buffer of the thread, reused for all its flags
+  std::vector<Term> terms;
+  while (true) {
+    int f = __sync_fetch_and_add(&batch->next, 1);
+    if (f >= batch->count)
+      break;
+    FlagTerms& flagTerms = (*batch->flagTerms)[f];
+    flagTerms.entries.clear();
+    flagTerms.factors.clear();
+    batch->matrix->collectFlagTerms(batch->first + f, terms);
+    addUpTerms(terms, flagTerms.entries, flagTerms.factors);
+  }
+}
+
+// Appends the terms of a flag F of the variable flag algebra to terms
+void CauchySchwarzMatrix::collectFlagTerms(int F, std::vector<Term>& terms) const {
+  for (int labelling = 0; labelling < restrictions->labellings(); labelling++) {
+    // the subflags of this labelling, by slot
+    const int* subFlags = restrictions->restrictions(F, labelling);
+
+    // now go through all pairs of disjoint subflags
+    for (int p = 0; p < pairSchedule.size(); p++) {
+      int i = pairSchedule[p].first, j = pairSchedule[p].second;
+
+      // now add 1/denominator * F to entries (F1, F2) and (F2, F1) in
+      // the matrix; if the two are the same diagonal entry, it gets the
+      // term twice
+      int F1index = subFlags[i], F2index = subFlags[j];
+      if (i != j)
+        addTerm(terms, F1index, F2index, F, (F1index == F2index) ? 2 : 1);
+      else
+        addTerm(terms, F1index, F2index, F, 1);
+    }
+  }
+}
+
+void CauchySchwarzMatrix::addTerm(std::vector<Term>& terms, const int F1index, const int F2index, const int Findex, const int factor) const {
   if ((F1index < 0) || (F2index < 0) || (Findex < 0))
     fatal_error("Cauchy-Schwarz matrix: encountered a flag that is not in the brick algebra. This should not happen.");
 
@@ -261,25 +209,84 @@ void CauchySchwarzMatrix::addTerm(const Configuration& F1, const Configuration&
   assert( (F2index >= 0) && (F2index < subFlagAlgebra->size()) );
   assert( (Findex >= 0) && (Findex < variableAlgebra->size()) );
 
-  boost::unordered_map<int, int>* matrixEntry = matrix[F1index][F2index];
-  if (matrixEntry == NULL)
-    matrixEntry = matrix[F1index][F2index] = new boost::unordered_map<int, int>();
+  // the term goes into the upper triangle
+  Term term = { std::min(F1index, F2index), std::max(F1index, F2index), Findex, factor };
+  terms.push_back(term);
+}
+
+// Adds up the terms of a flag, puts them in order and appends their
+// entries and factors; empties terms
+void CauchySchwarzMatrix::addUpTerms(std::vector<Term>& terms, std::vector<std::pair<int, int> >& entries,
+                                     std::vector<int>& factors) {
+  std::sort(terms.begin(), terms.end(), Term::lessByFlag);
+
+  for (int t = 0; t < terms.size(); ) {
+    const Term& term = terms[t];
+    assert(term.F == terms[0].F);
+    int factor = 0;
+    for (; (t < terms.size()) && (terms[t].i == term.i) && (terms[t].j == term.j); t++)
+      factor += terms[t].factor;
+    entries.push_back(make_pair(term.i, term.j));
+    factors.push_back(factor);
+  }
+  terms.clear();
+}
 
-  (*matrixEntry)[Findex] = (*matrixEntry)[Findex] + factor;
+// Indexes the terms by entry
+void CauchySchwarzMatrix::freeze() {
+  int nsub = this->subFlagAlgebra->size();
 
+  std::vector<Term> terms(flagEntries.size());
+  for (int F = 0; F + 1 < flagStart.size(); F++)
+    for (int t = flagStart[F]; t < flagStart[F + 1]; t++) {
+      terms[t].i = flagEntries[t].first;
+      terms[t].j = flagEntries[t].second;
+      terms[t].F = F;
+      terms[t].factor = flagFactors[t];
+    }
+  std::sort(terms.begin(), terms.end(), Term::lessByEntry);
+
+  rowStart.assign(nsub + 1, 0);
+  cellColumn.clear();
+  cellStart.clear();
+  cellFlags.resize(terms.size());
+  cellFactors.resize(terms.size());
+  for (int t = 0; t < terms.size(); t++) {
+    if ((t == 0) || (terms[t].i != terms[t - 1].i) || (terms[t].j != terms[t - 1].j)) {
+      rowStart[terms[t].i + 1]++;
+      cellColumn.push_back(terms[t].j);
+      cellStart.push_back(t);
+    }
+    cellFlags[t] = terms[t].F;
+    cellFactors[t] = terms[t].factor;
+  }
+  cellStart.push_back(terms.size());
+  for (int i = 0; i < nsub; i++)
+    rowStart[i + 1] += rowStart[i];
+}
 
-  nonemptyEntries[Findex].insert(make_pair(F1index, F2index));
+// Returns the cell of entry (i, j), or -1 if the entry is empty
+int CauchySchwarzMatrix::findCell(const int i, const int j) const {
+  std::vector<int>::const_iterator first = cellColumn.begin() + rowStart[i];
+  std::vector<int>::const_iterator last = cellColumn.begin() + rowStart[i + 1];
+  std::vector<int>::const_iterator it = std::lower_bound(first, last, j);
+  if ((it == last) || (*it != j))
+    return -1;
+  return it - cellColumn.begin();
 }
 
 int CauchySchwarzMatrix::getFactor(const int i, const int j, const int F) const {
-  boost::unordered_map<int, int>* matrixEntry = matrix[i][j];
-  if ((matrixEntry == NULL) || (matrixEntry->size() == 0))
+  int cell = findCell(std::min(i, j), std::max(i, j));
+  if (cell < 0)
     return 0;
-  boost::unordered_map<int, int>::const_iterator it = matrixEntry->find(F);
-  if (it == matrixEntry->end())
+
+  std::vector<int>::const_iterator first = cellFlags.begin() + cellStart[cell];
+  std::vector<int>::const_iterator last = cellFlags.begin() + cellStart[cell + 1];
+  std::vector<int>::const_iterator it = std::lower_bound(first, last, F);
+  if ((it == last) || (*it != F))
     return 0;
 
-  return it->second;
+  return cellFactors[it - cellFlags.begin()];
 }
 
 void CauchySchwarzMatrix::writeMexSparseMatrix(std::ostream& stream) {
@@ -291,17 +298,11 @@ void CauchySchwarzMatrix::writeMexSparseMatrix(std::ostream& stream) {
 
   stream << "short sparseMatrix[] = {";
   for (int i = 0; i < nsub; i++)
-    for (int j = i; j < nsub; j++) {
-      boost::unordered_map<int, int>* matrixEntry = matrix[i][j];
-      if ((matrixEntry == NULL) || (matrixEntry->size() == 0))
-        continue;
-      stream << i << "," << j << "," << matrixEntry->size() << ",";
-      boost::unordered_map<int, int>::const_iterator it;
-      for (it = matrixEntry->begin(); it != matrixEntry->end(); ++it) {
-        int Findex = it->first;
-        int factor = it->second;
-        stream << Findex << "," << factor << ",";
-      }
+    for (int cell = rowStart[i]; cell < rowStart[i + 1]; cell++) {
+      int j = cellColumn[cell];
+      stream << i << "," << j << "," << (cellStart[cell + 1] - cellStart[cell]) << ",";
+      for (int t = cellStart[cell]; t < cellStart[cell + 1]; t++)
+        stream << cellFlags[t] << "," << cellFactors[t] << ",";
       stream << endl;
     }
 
@@ -339,13 +340,24 @@ void CauchySchwarzMatrix::writeAsMathematicaVariable(std::ostream& stream, std::
   for (int F = 0; F < variableAlgebra->size(); F++) {
     stream << variableName << "[[" << (F+1) << "]] = SparseArray[{";
 
-    const boost::unordered_set<pair<int, int> >& list = getNonemptyEntries(F);
-    boost::unordered_set<pair<int, int> >::const_iterator it;
+    // the whole matrix is written, so the stored entries are mirrored
+    // and put back in order
+    std::vector<Term> terms;
+    for (int t = flagStart[F]; t < flagStart[F + 1]; t++) {
+      Term term = { flagEntries[t].first, flagEntries[t].second, F, flagFactors[t] };
+      terms.push_back(term);
+      if (term.i != term.j) {
+        std::swap(term.i, term.j);
+        terms.push_back(term);
+      }
+    }
+    std::sort(terms.begin(), terms.end(), Term::lessByEntry);
+
     int nterms = 0;
-    for (it = list.begin(); it != list.end(); ++it) {
-      int i = it->first;
-      int j = it->second;
-      int factor = getFactor(i, j, F);
+    for (int t = 0; t < terms.size(); t++) {
+      int i = terms[t].i;
+      int j = terms[t].j;
+      int factor = terms[t].factor;
 
       if (factor == 0) continue;
 
@@ -363,39 +375,47 @@ void CauchySchwarzMatrix::writeProducts(std::string filename) const {
   int nvar = this->variableAlgebra->size();
   int nsub = this->subFlagAlgebra->size();
 
-  const std::vector<Configuration>& subFlags = subFlagAlgebra->getFlagList();
-  const std::vector<Configuration>& variableFlags = variableAlgebra->getFlagList();
+  const FlagStore& subFlags = subFlagAlgebra->getFlagList();
+  const FlagStore& variableFlags = variableAlgebra->getFlagList();
 
   std::ofstream stream( filename.c_str() );
 
+  // the cells below the diagonal are the cells above it with row and
+  // column exchanged; list them, with their rows, by column
+  std::vector<std::vector<std::pair<int, int> > > lowerCells(nsub);
   for (int i = 0; i < nsub; i++)
-    for (int j = 0; j < nsub; j++) {
-      boost::unordered_map<int, int>* matrixEntry = matrix[i][j];
-      if ((matrixEntry == NULL) || (matrixEntry->size() == 0))
-        continue;
+    for (int cell = rowStart[i]; cell < rowStart[i + 1]; cell++)
+      if (cellColumn[cell] != i)
+        lowerCells[cellColumn[cell]].push_back(make_pair(cell, i));
+
+  for (int i = 0; i < nsub; i++) {
+    int lowerCount = lowerCells[i].size();
+    for (int c = 0; c < lowerCount + rowStart[i + 1] - rowStart[i]; c++) {
+      int cell, j;
+      if (c < lowerCount) {
+        cell = lowerCells[i][c].first;
+        j = lowerCells[i][c].second;
+      } else {
+        cell = rowStart[i] + c - lowerCount;
+        j = cellColumn[cell];
+      }
 
       stream << "Entry (" << (1+i) << "," << (1+j) << "): [" << subFlags[i] << "] x [" << subFlags[j] << "] = ";
 
-      boost::unordered_map<int, int>::const_iterator it;
-      for (it = matrixEntry->begin(); it != matrixEntry->end(); ++it) {
-        if (it != matrixEntry->begin())
+      for (int t = cellStart[cell]; t < cellStart[cell + 1]; t++) {
+        if (t != cellStart[cell])
           stream << " + ";
-        int Findex = it->first;
-        int factor = it->second;
-        stream << factor << " [" << variableFlags[Findex] << "]";
+        stream << cellFactors[t] << " [" << variableFlags[cellFlags[t]] << "]";
       }
       stream << std::endl;
     }
+  }
   stream.close();
 
 }
 
-const boost::unordered_set<std::pair<int, int> >& CauchySchwarzMatrix::getNonemptyEntries(int F) const {
-  boost::unordered_map<int, boost::unordered_set<std::pair<int, int> > >::const_iterator it = this->nonemptyEntries.find(F);
-  if (it == this->nonemptyEntries.end())
-    return this->emptyList;
-  else
-    return it->second;
+CauchySchwarzMatrix::EntryList CauchySchwarzMatrix::getNonemptyEntries(int F) const {
+  if ((F + 1 >= flagStart.size()) || (flagStart[F] == flagStart[F + 1]))
+    return EntryList(NULL, NULL, NULL);
+  return EntryList(&flagEntries[flagStart[F]], &flagEntries[0] + flagStart[F + 1], &flagFactors[flagStart[F]]);
 }
-
-
@@ -1,46 +1,131 @@
 #ifndef __CAUCHYSCHWARZMATRIX_H__
 #define __CAUCHYSCHWARZMATRIX_H__
 
-#include <boost/unordered_map.hpp>
-#include <boost/unordered_set.hpp>
 #include <iostream>
 #include <vector>
 #include <utility>
 #include "brickalgebra.h"
+#include "restrictiontable.h"
 #include "configuration.h"
 
+// The number of flags whose terms are collected at the same time
+#define CSMATRIX_BATCH_SIZE 256
+
 class CauchySchwarzMatrix {
  private:
   int _subN, _subK, _subNlabelled, _subKlabelled, _denominator;
 
-  // This is a two dimensional array representing the Cauchy Schwarz
-  // matrix. Each entry is represented by a map that maps each
-  // flag in the variable flag algebra to an integer c. This integer
-  // is denominator() times the factor in front of the flag.
-  boost::unordered_map<int, int>*** matrix;
-
-  // This map stores for each flag in the variable flag algebra
-  // a set of indices in the matrix in which the flag appears
-  boost::unordered_map<int, boost::unordered_set<std::pair<int, int> > > nonemptyEntries;
-
-  // Empty list to be returned by getNonemptyEntries if necessary
-  boost::unordered_set<std::pair<int, int> > emptyList;
-
-  BrickAlgebra* subFlagAlgebra;
+  // the number of ways to choose the unlabelled vertices of two disjoint
+  // subflags for a given labelling
+  int disjointChoices;
+
+  /* The matrix is a sparse tensor of terms (i, j, F, c): entry (i, j)
+     of the matrix contains c times the flag F of the variable flag
+     algebra, where c is denominator() times the factor in front of the
+     flag. During construction the terms of a flag are appended to
+     pendingTerms; addFlagTerms sorts them and adds them up, and freeze
+     indexes the result by entry once all flags have been done.
+
+     The matrix is symmetric, so only the terms with i <= j are stored;
+     entry (j, i) is the same as entry (i, j).
+
+     The terms of different flags are collected on different threads,
+     in batches of flags; every flag gets its own FlagTerms, which are
+     appended in the order of the flags. */
+  struct Term {
+    int i, j, F, factor;
+
+    static bool lessByFlag(const Term& a, const Term& b) {
+      if (a.F != b.F) return a.F < b.F;
+      if (a.i != b.i) return a.i < b.i;
+      return a.j < b.j;
+    }
+    static bool lessByEntry(const Term& a, const Term& b) {
+      if (a.i != b.i) return a.i < b.i;
+      if (a.j != b.j) return a.j < b.j;
+      return a.F < b.F;
+    }
+  };
+  struct FlagTerms {
+    std::vector<std::pair<int, int> > entries;
+    std::vector<int> factors;
+  };
+  friend struct ConstructionBatch;
+
+  // The subflags of the variable flags, for every labelling and every
+  // choice of unlabelled vertices (slot). Whether the unlabelled vertices
+  // of two slots are disjoint only depends on the shape of the matrix,
+  // so the pairs (s, t), s <= t, of disjoint slots are listed once, in
+  // pairSchedule.
+  const RestrictionTable* restrictions;
+  std::vector<std::pair<int, int> > pairSchedule;
+  void buildPairSchedule();
+
+  // the terms ordered by flag: the entries and factors of the terms of
+  // flag F are at positions flagStart[F], ..., flagStart[F+1]-1, ordered
+  // by entry
+  std::vector<int> flagStart;
+  std::vector<std::pair<int, int> > flagEntries;
+  std::vector<int> flagFactors;
+
+  // the terms ordered by entry: the nonempty entries of row i are cells
+  // rowStart[i], ..., rowStart[i+1]-1, with their columns in cellColumn,
+  // and the flags and factors of cell c are at positions cellStart[c],
+  // ..., cellStart[c+1]-1 of cellFlags and cellFactors, ordered by flag
+  std::vector<int> rowStart, cellColumn, cellStart;
+  std::vector<int> cellFlags, cellFactors;
+
+  const BrickAlgebra* subFlagAlgebra;
   const BrickAlgebra* variableAlgebra;
-  void addTerm(const Configuration& F1, const Configuration& F2, const Configuration& F, const int factor);
-  void allocateMatrix();
+  static void collectTerms(void* argument, int thread, int threadCount);
+  void collectFlagTerms(int F, std::vector<Term>& terms) const;
+  void addTerm(std::vector<Term>& terms, const int F1index, const int F2index, const int Findex, const int factor) const;
+  static void addUpTerms(std::vector<Term>& terms, std::vector<std::pair<int, int> >& entries, std::vector<int>& factors);
+  void freeze();
+  int findCell(const int i, const int j) const;
   void writeMexSparseMatrix(std::ostream& stream);
 
 
  public:
+  // The entries (i, j) with i <= j in which a flag appears, ordered by
+  // entry, with the factors of the flag in them
+  class EntryList {
+   public:
+    typedef const std::pair<int, int>* const_iterator;
+   private:
+    const_iterator first, last;
+    const int* factors;
+   public:
+    EntryList(const_iterator first, const_iterator last, const int* factors)
+      : first(first), last(last), factors(factors) {}
+    const_iterator begin() const {
+      return first;
+    }
+    const_iterator end() const {
+      return last;
+    }
+    int size() const {
+      return last - first;
+    }
+    // same as getFactor(it->first, it->second, F), without a search
+    int factor(const_iterator it) const {
+      return factors[it - first];
+    }
+  };
+
   CauchySchwarzMatrix(const BrickAlgebra& variableAlgebra);
-  ~CauchySchwarzMatrix();
 
   void construct(int Nlabelled, int Klabelled, int Nunlabelled, int Kunlabelled);
 
-  const boost::unordered_set<std::pair<int, int> >& getNonemptyEntries(int F) const;
+  EntryList getNonemptyEntries(int F) const;
   int getFactor(const int i, const int j, const int F) const;
+
+  // the number of times a stored entry (i, j) appears in the matrix: once
+  // on the diagonal, and twice, as (i, j) and (j, i), off the diagonal
+  static int multiplicity(const int i, const int j) {
+    return (i == j) ? 1 : 2;
+  }
+
   int size() const {
     return this->subFlagAlgebra->size();
   }
@@ -141,8 +141,7 @@ int main(int argc, char* argv[]) {
   double z = toDouble(argv[3]);
   cerr << "Checking certificate for N=" << N << ", K=" << K << ", z=" << z << endl;
 
-  BrickAlgebra variables(N, K, 0, 0);
-  variables.constructElements();
+  const BrickAlgebra& variables = BrickAlgebra::shared(N, K, 0, 0);
 
   CauchySchwarzMatrix M1(variables);
   CauchySchwarzMatrix M2(variables);
@@ -190,16 +189,16 @@ int main(int argc, char* argv[]) {
     for (int m = 0; m < inequalities.size(); m++) {
       if (inequalities[m].type == CS) {
         CauchySchwarzMatrix* M = matrices[inequalities[m].matrix - 1];
-        const unordered_set<pair<int, int> >& list = M->getNonemptyEntries(F);
+        CauchySchwarzMatrix::EntryList list = M->getNonemptyEntries(F);
         if (list.size() == 0)
           continue;
 
-        unordered_set<pair<int, int> >::const_iterator it;
+        CauchySchwarzMatrix::EntryList::const_iterator it;
         cout << "-(" << abs(inequalities[m].dual) << ")*(0";
         for (it = list.begin(); it != list.end(); ++it) {
           int i = it->first;
           int j = it->second;
-          rational<int> factor = M->getFactor(i, j, F);
+          rational<int> factor = list.factor(it) * CauchySchwarzMatrix::multiplicity(i, j);
           rational<int> wi = inequalities[m].weights[i];
           rational<int> wj = inequalities[m].weights[j];
 
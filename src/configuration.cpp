@@ -7,49 +7,140 @@
 
 #include "configuration.h"
 #include "brickvector.h"
+#include "canonsearch.h"
+#include "relabel.h"
 
 Configuration::Configuration() {
-  this->vector = NULL;
+  this->packed = NULL;
 }
 
 Configuration::~Configuration() {
-  if (this->vector != NULL)
-    free_vector(this->vector);
+  release();
+}
+
+// Points packed at room for a packed vector of the given length
+void Configuration::allocate(int length) {
+  if (length <= CONFIGURATION_INLINE_LENGTH)
+    this->packed = this->storage;
+  else
+    this->packed = new CFINT[length];
+}
+
+void Configuration::release() {
+  if ((this->packed != NULL) && (this->packed != this->storage))
+    delete[] this->packed;
+  this->packed = NULL;
+}
+
+void Configuration::copyFrom(const Configuration& source) {
+  if (source.packed == NULL) {
+    this->packed = NULL;
+    return;
+  }
+  int length = getPackedLength(source.packed);
+  allocate(length);
+  memcpy(this->packed, source.packed, sizeof(CFINT) * length);
 }
 
 Configuration::Configuration(const CFINT* vector) {
-  this->vector = copy_vector(vector);
+  allocate(getPackedLength(vector));
+  pack_vector(vector, this->packed);
 }
 
 Configuration::Configuration(const Configuration &configuration) {
-  this->vector = copy_vector(configuration.vector);
+  copyFrom(configuration);
+}
+
+Configuration::Configuration(const ConfigurationView& view) {
+  int length = getPackedLength(view.packedVector());
+  allocate(length);
+  memcpy(this->packed, view.packedVector(), sizeof(CFINT) * length);
 }
 
 Configuration& Configuration::operator = ( const Configuration& source ) {
-  if (this->vector != NULL)
-    free_vector(this->vector);
-  this->vector = copy_vector(source.vector);
+  if (this == &source)
+    return *this;
+
+  // reuse the inline storage if the source fits
+  if ((this->packed == this->storage) && (source.packed != NULL)
+      && (getPackedLength(source.packed) <= CONFIGURATION_INLINE_LENGTH)) {
+    memcpy(this->storage, source.packed, sizeof(CFINT) * getPackedLength(source.packed));
+    return *this;
+  }
+
+  release();
+  copyFrom(source);
   return *this;
 }
 
-Configuration Configuration::canonicalForm(bool permuteLabelledVertices) const {
-  // construct a copy of this configuration's vector
-  CFINT* cf_vector = copy_vector(this->vector);
+Configuration& Configuration::operator = ( const ConfigurationView& source ) {
+  int length = getPackedLength(source.packedVector());
+  if ((this->packed != this->storage) || (length > CONFIGURATION_INLINE_LENGTH)) {
+    release();
+    allocate(length);
+  }
+  memcpy(this->packed, source.packedVector(), sizeof(CFINT) * length);
+  return *this;
+}
 
-  // calculate canonical form
-  calc_canonical(cf_vector, permuteLabelledVertices);
+#if __cplusplus >= 201103L
+// Moving takes over a heap array; inline vectors are copied
+Configuration::Configuration(Configuration&& configuration) {
+  if (configuration.packed == configuration.storage)
+    copyFrom(configuration);
+  else {
+    this->packed = configuration.packed;
+    configuration.packed = NULL;
+  }
+}
+
+Configuration& Configuration::operator = (Configuration&& source) {
+  if (this == &source)
+    return *this;
 
-  // construct a new configuration object with the
-  // canonical form as its vector
-  Configuration cf_config = Configuration();
-  cf_config.vector = cf_vector;
+  if (source.packed == source.storage)
+    return *this = static_cast<const Configuration&>(source);
+
+  release();
+  this->packed = source.packed;
+  source.packed = NULL;
+  return *this;
+}
+#endif
 
+Configuration Configuration::canonicalForm(bool permuteLabelledVertices) const {
+  Configuration cf_config(*this);
+  cf_config.putInCanonicalForm(permuteLabelledVertices);
   return cf_config;
 }
 
 void Configuration::putInCanonicalForm(bool permuteLabelledVertices) {
-  // calculate canonical form
-  calc_canonical(this->vector, permuteLabelledVertices);
+  // calculate canonical form on the unpacked vector
+  CFINT vector[vectorLength()];
+  unpack_vector(this->packed, vector);
+  calc_canonical(vector, permuteLabelledVertices);
+  pack_vector(vector, this->packed);
+}
+
+// Puts the configuration in canonical form, and returns the labelling that
+// was applied together with the automorphism group of the configuration
+void Configuration::putInCanonicalForm(bool permuteLabelledVertices, CanonicalLabelling& labelling) {
+  CFINT vector[vectorLength()];
+  unpack_vector(this->packed, vector);
+  search_canonical(vector, permuteLabelledVertices, &labelling);
+  pack_vector(vector, this->packed);
+}
+
+// Relabels the vertices according to a canonical labelling of this
+// configuration (or of one with the same vertices) and sorts the crossings
+void Configuration::relabel(const CanonicalLabelling& labelling) {
+  reindexN(labelling.labelN);
+  reindexK(labelling.labelK);
+  sortCrossings();
+}
+
+void Configuration::sortCrossings() {
+  sort_packed_crossings(this->packed);
 }
 
 void Configuration::reindexN(const CFINT* newIndexN) {
@@ -62,13 +153,9 @@ void Configuration::reindexN(const CFINT* newIndexN) {
   assert(vertN.count() == getN());
 #endif
 
-  // this should go into brickvector!!!
-  int crossings = vector[4];
-  for (int i = 0; i < crossings; i++) {
-    vector[5 + i * 4] = newIndexN[vector[5 + i * 4]];
-    vector[5 + i * 4 + 2] = newIndexN[vector[5 + i * 4 + 2]];
-  }
-  SANITY_CHECK(vector);
+  CFINT* keys = &packed[CROSSING_OFFSET];
+  relabel_crossing_keys(keys, keys, packed[4], newIndexN, NULL);
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::reindexK(const CFINT* newIndexK) {
@@ -81,57 +168,49 @@ void Configuration::reindexK(const CFINT* newIndexK) {
   assert(vertK.count() == getK());
 #endif
 
-  // this should go into brickvector!!!
-  int crossings = vector[4];
-  for (int i = 0; i < crossings; i++) {
-    vector[5 + i * 4 + 1] = newIndexK[vector[5 + i * 4 + 1]];
-    vector[5 + i * 4 + 3] = newIndexK[vector[5 + i * 4 + 3]];
-  }
-  SANITY_CHECK(vector);
+  CFINT* keys = &packed[CROSSING_OFFSET];
+  relabel_crossing_keys(keys, keys, packed[4], NULL, newIndexK);
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::keepNvertices(int count) {
-  std::vector<int> keepCrossings;
-  int crossings = vector[4];
+  int crossings = packed[4];
+  CFINT* keys = &packed[CROSSING_OFFSET];
+  int kept = 0;
   for (int i = 0; i < crossings; i++) {
     // check if crossing involves a top vertex >= count
-    if (vector[5 + i * 4 + 0] >= count) continue;
-    if (vector[5 + i * 4 + 2] >= count) continue;
-    keepCrossings.push_back(i);
+    if (((keys[i] >> 9) & 7) >= count) continue;
+    if (((keys[i] >> 3) & 7) >= count) continue;
+    keys[kept++] = keys[i];
   }
-  vector[4] = (CFINT) keepCrossings.size();
-  for (int i = 0; i < keepCrossings.size(); i++)
-    if (keepCrossings[i] != i)
-      memcpy(&vector[5 + i * 4], &vector[5 + keepCrossings[i] * 4], sizeof(CFINT) * 4);
-  vector[0] = (CFINT) count;
-  SANITY_CHECK(vector);
+  packed[4] = (CFINT) kept;
+  packed[0] = (CFINT) count;
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::keepKvertices(int count) {
-  std::vector<int> keepCrossings;
-  int crossings = (CFINT) vector[4];
+  int crossings = packed[4];
+  CFINT* keys = &packed[CROSSING_OFFSET];
+  int kept = 0;
   for (int i = 0; i < crossings; i++) {
-    // check if crossing involves a top vertex >= count
-    if (vector[5 + i * 4 + 1] >= count) continue;
-    if (vector[5 + i * 4 + 3] >= count) continue;
-    keepCrossings.push_back(i);
+    // check if crossing involves a bottom vertex >= count
+    if (((keys[i] >> 6) & 7) >= count) continue;
+    if ((keys[i] & 7) >= count) continue;
+    keys[kept++] = keys[i];
   }
-  vector[4] = (CFINT) keepCrossings.size();
-  for (int i = 0; i < keepCrossings.size(); i++)
-    if (keepCrossings[i] != i)
-      memcpy(&vector[5 + i * 4], &vector[5 + keepCrossings[i] * 4], sizeof(CFINT) * 4);
-  vector[1] = (CFINT) count;
-  SANITY_CHECK(vector);
+  packed[4] = (CFINT) kept;
+  packed[1] = (CFINT) count;
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::setNlabelled(const int newNlabelled) {
-  vector[2] = (CFINT) newNlabelled;
-  SANITY_CHECK(vector);
+  packed[2] = (CFINT) newNlabelled;
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::setKlabelled(const int newKlabelled) {
-  vector[3] = (CFINT) newKlabelled;
-  SANITY_CHECK(vector);
+  packed[3] = (CFINT) newKlabelled;
+  SANITY_CHECK_PACKED(packed);
 }
 
 void Configuration::print() const {
@@ -143,42 +222,62 @@ void Configuration::println() const {
 }
 
 void Configuration::print(std::ostream& stream) const {
-  print_vector(this->vector, stream);
+  if (this->packed == NULL) {
+    print_vector(NULL, stream);
+    return;
+  }
+  CFINT vector[vectorLength()];
+  getVector(vector);
+  print_vector(vector, stream);
 }
 
 void Configuration::println(std::ostream& stream) const {
-  print_vector(this->vector, stream);
+  print(stream);
   stream << std::endl;
 }
 
+void Configuration::getVector(CFINT* vector) const {
+  unpack_vector(this->packed, vector);
+}
+
+int Configuration::vectorLength() const {
+  return getLength(packed);
+}
+
+const CFINT* Configuration::packedVector() const {
+  return packed;
+}
+
+ConfigurationView Configuration::view() const {
+  return ConfigurationView(packed);
+}
+
 int Configuration::crossingCount() const {
-  return vector[4];
+  return packed[4];
 }
 
 int Configuration::getN() const {
-  return vector[0];
+  return packed[0];
 }
 
 int Configuration::getK() const {
-  return vector[1];
+  return packed[1];
 }
 
 int Configuration::getNlabelled() const {
-  return vector[2];
+  return packed[2];
 }
 
 int Configuration::getKlabelled() const {
-  return vector[3];
+  return packed[3];
 }
 
 bool Configuration::equals(Configuration const& b) const {
-  return vectors_equals(vector, b.vector);
+  return packed_vectors_equals(packed, b.packed);
 }
 
 std::size_t Configuration::hash_value() const {
-  if (this->vector == NULL) return 0;
-
-  return vector_hash_value(vector);
+  return packed_vector_hash_value(packed);
 }
 
 void constructNewIndex(CFINT* newIndex, int vertexCount, CFINT* label, int labelCount) {
@@ -199,37 +298,34 @@ void constructNewIndex(CFINT* newIndex, int vertexCount, CFINT* label, int label
 }
 
 void Configuration::labelKvertices(CFINT* labelK, int count) {
-  int K = vector[1];
+  int K = packed[1];
   CFINT newindexK[K];
   constructNewIndex(newindexK, K, labelK, count);
 
   reindexK(newindexK);
   setKlabelled(count);
-  SANITY_CHECK(vector);
 }
 
 void Configuration::labelNvertices(CFINT* labelN, int count) {
-  int N = vector[0];
+  int N = packed[0];
   CFINT newindexN[N];
   constructNewIndex(newindexN, N, labelN, count);
 
   reindexN(newindexN);
   setNlabelled(count);
-  SANITY_CHECK(vector);
 }
 
 /* Turns configuration upside down, i.e. swapping N and K side */
 void Configuration::flip() {
   // swap N and K counts
-  std::swap<CFINT>(vector[0], vector[1]);
-  std::swap<CFINT>(vector[2], vector[3]);
+  std::swap<CFINT>(packed[0], packed[1]);
+  std::swap<CFINT>(packed[2], packed[3]);
 
-  // swap crossings
-  int crossings = vector[4];
-  for (int i = 0; i < crossings; i++) {
-    std::swap<CFINT>(vector[5 + i * 4],     vector[5 + i * 4 + 1]);
-    std::swap<CFINT>(vector[5 + i * 4 + 2], vector[5 + i * 4 + 3]);
-  }
+  // swap the endpoints of every edge, i.e. the 3-bit fields of each key
+  int crossings = packed[4];
+  CFINT* keys = &packed[CROSSING_OFFSET];
+  for (int i = 0; i < crossings; i++)
+    keys[i] = ((keys[i] & 07070) >> 3) | ((keys[i] & 00707) << 3);
 
 }
 
@@ -242,3 +338,34 @@ std::ostream& operator<< (std::ostream& stream, const Configuration& config) {
   return stream;
 }
 
+void ConfigurationView::print(std::ostream& stream) const {
+  CFINT vector[vectorLength()];
+  getVector(vector);
+  print_vector(vector, stream);
+}
+
+void ConfigurationView::getVector(CFINT* vector) const {
+  unpack_vector(this->packed, vector);
+}
+
+int ConfigurationView::vectorLength() const {
+  return getLength(packed);
+}
+
+std::size_t ConfigurationView::hash_value() const {
+  return packed_vector_hash_value(packed);
+}
+
+bool operator==(ConfigurationView const& a, Configuration const& b) {
+  return packed_vectors_equals(a.packedVector(), b.packedVector());
+}
+
+bool operator==(ConfigurationView const& a, ConfigurationView const& b) {
+  return packed_vectors_equals(a.packedVector(), b.packedVector());
+}
+
+std::ostream& operator<< (std::ostream& stream, const ConfigurationView& view) {
+  view.print(stream);
+  return stream;
+}
+
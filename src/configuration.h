@@ -5,15 +5,40 @@
 
 #include "turan.h"
 
+struct CanonicalLabelling;
+class ConfigurationView;
+
+// A configuration is stored as a packed brick vector (see brickvector.h),
+// so that comparing and hashing configurations only touches one key per
+// crossing. The constructor and getVector convert from and to ordinary
+// brick vectors.
+//
+// Packed vectors of up to CONFIGURATION_INLINE_LENGTH entries (that is,
+// configurations with up to 27 crossings) are kept inside the object, so
+// that copying them does not allocate; longer ones go on the heap.
+#define CONFIGURATION_INLINE_LENGTH 32
+
 class Configuration {
  private:
-  CFINT* vector;
+  // points to storage, to a heap array, or is NULL for an empty object
+  CFINT* packed;
+  CFINT storage[CONFIGURATION_INLINE_LENGTH];
+
+  void allocate(int length);
+  void release();
+  void copyFrom(const Configuration& source);
  public:
   Configuration();
   Configuration(const CFINT* vector);
   Configuration(const Configuration &config);
+  Configuration(const ConfigurationView& view);
   ~Configuration();
   Configuration& operator = ( const Configuration& source );
+  Configuration& operator = ( const ConfigurationView& source );
+#if __cplusplus >= 201103L
+  Configuration(Configuration&& config);
+  Configuration& operator = (Configuration&& source);
+#endif
 
   Configuration canonicalForm(bool permuteLabelledVertices) const;
   void print() const;
@@ -26,12 +51,24 @@ class Configuration {
   void setNlabelled(const int newNlabelled);
   void setKlabelled(const int newKlabelled);
   void putInCanonicalForm(bool permuteLabelledVertices);
+  void putInCanonicalForm(bool permuteLabelledVertices, CanonicalLabelling& labelling);
+  void relabel(const CanonicalLabelling& labelling);
+  void sortCrossings();
 
   void labelKvertices(CFINT* labelK, int count);
   void labelNvertices(CFINT* labelN, int count);
   void keepNvertices(int count); // deletes top vertices count, ..., N-1
   void keepKvertices(int count); // deletes top vertices count, ..., K-1
 
+  // copies the configuration into vector as an ordinary brick vector,
+  // which must have room for vectorLength() entries
+  void getVector(CFINT* vector) const;
+  int vectorLength() const;
+
+  // the packed vector, for storing the configuration elsewhere
+  const CFINT* packedVector() const;
+  ConfigurationView view() const;
+
   int crossingCount() const;
   int getN() const;
   int getK() const;
@@ -53,8 +90,48 @@ struct configuration_hash {
 };
 
 
+// A read-only reference to a packed vector that is stored elsewhere, such
+// as a flag of a BrickAlgebra. A view is only valid as long as the storage
+// it refers to; copy it into a Configuration to keep or modify it.
+class ConfigurationView {
+ private:
+  const CFINT* packed;
+ public:
+  ConfigurationView(const CFINT* packed) : packed(packed) { }
+
+  const CFINT* packedVector() const {
+    return packed;
+  }
+
+  void print(std::ostream& stream) const;
+  void getVector(CFINT* vector) const;
+  int vectorLength() const;
+
+  int crossingCount() const {
+    return packed[4];
+  }
+  int getN() const {
+    return packed[0];
+  }
+  int getK() const {
+    return packed[1];
+  }
+  int getNlabelled() const {
+    return packed[2];
+  }
+  int getKlabelled() const {
+    return packed[3];
+  }
+
+  // same hash as Configuration::hash_value
+  std::size_t hash_value() const;
+};
+
 bool operator==(Configuration const& a, Configuration const& b);
+bool operator==(ConfigurationView const& a, Configuration const& b);
+bool operator==(ConfigurationView const& a, ConfigurationView const& b);
 std::ostream& operator<< (std::ostream& stream, const Configuration& config);
+std::ostream& operator<< (std::ostream& stream, const ConfigurationView& view);
 
 
 #endif // __CONFIGURATION_H__
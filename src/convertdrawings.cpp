@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include "turan.h"
+#include "drawingfile.h"
+
+using namespace std;
+
+// Converts a drawing file between the text and the binary format (see
+// drawingfile.h), e.g. drNK.txt into drNK.bin. The output is written in
+// binary if its name ends in .bin, and as text otherwise.
+int main(int argc, char* argv[]) {
+  if (argc != 3)
+    fatal_error("Usage: " << argv[0] << " input output\n"
+                "Writes the drawings of the input file to the output file, in binary if its name ends in .bin.");
+
+  string input(argv[1]), output(argv[2]);
+  bool binary = (output.size() >= 4) && (output.compare(output.size() - 4, 4, ".bin") == 0);
+
+  DrawingReader reader;
+  if (!reader.open(input))
+    fatal_error("Could not open file " << input);
+
+  DrawingWriter writer;
+  if (!writer.open(output, binary))
+    fatal_error("Could not open file " << output << " for writing");
+
+  int drawingCount = 0;
+  for (const CFINT* packed = reader.next(); packed != NULL; packed = reader.next()) {
+    writer.add(packed);
+    drawingCount++;
+  }
+
+  if (!writer.close())
+    fatal_error("Could not write file " << output);
+
+  cout << "Converted " << drawingCount << " drawings from " << (reader.isBinary() ? "binary" : "text")
+       << " to " << (binary ? "binary" : "text") << "." << endl;
+}
@@ -0,0 +1,210 @@
+#include "crossingset.h"
+#include "brickvector.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CROSSINGSET_BMI2
+#include <immintrin.h>
+#endif
+
+/* Tables shared by all crossing sets: the crossing key of every pair,
+   the pair of every (normalized) crossing key, and for every set of top
+   or bottom vertices the pairs whose four endpoints are in the set. */
+
+struct CrossingSetTables {
+  CFINT pairKey[CROSSINGSET_PAIRS];
+  short keyPair[1 << 12];
+  uint64_t keepN[1 << MAXN][CROSSINGSET_WORDS];
+  uint64_t keepK[1 << MAXK][CROSSINGSET_WORDS];
+
+  CrossingSetTables() {
+    for (int key = 0; key < (1 << 12); key++)
+      keyPair[key] = -1;
+    memset(keepN, 0, sizeof(keepN));
+    memset(keepK, 0, sizeof(keepK));
+
+    // keys are enumerated in increasing order, so that the pairs are too
+    int pair = 0;
+    for (int key = 0; key < (1 << 12); key++) {
+      CFINT cr[4];
+      unpack_crossing_key(key, cr);
+      if ((cr[0] >= cr[2]) || (cr[2] >= MAXN) || (cr[1] == cr[3]) || (cr[1] >= MAXK) || (cr[3] >= MAXK))
+        continue;
+
+      pairKey[pair] = key;
+      keyPair[key] = pair;
+      for (unsigned set = 0; set < (1u << MAXN); set++)
+        if ((set & (1u << cr[0])) && (set & (1u << cr[2])))
+          keepN[set][pair / 64] |= 1ULL << (pair % 64);
+      for (unsigned set = 0; set < (1u << MAXK); set++)
+        if ((set & (1u << cr[1])) && (set & (1u << cr[3])))
+          keepK[set][pair / 64] |= 1ULL << (pair % 64);
+      pair++;
+    }
+    assert(pair == CROSSINGSET_PAIRS);
+  }
+};
+
+static const CrossingSetTables tables;
+
+CrossingSet::CrossingSet() {
+  N = K = Nlabelled = Klabelled = 0;
+  memset(bits, 0, sizeof(bits));
+}
+
+CrossingSet::CrossingSet(const Configuration& config) {
+  assign(config.packedVector());
+}
+
+CrossingSet::CrossingSet(const ConfigurationView& view) {
+  assign(view.packedVector());
+}
+
+void CrossingSet::assign(const CFINT* packed) {
+  N = packed[0];
+  K = packed[1];
+  Nlabelled = packed[2];
+  Klabelled = packed[3];
+  memset(bits, 0, sizeof(bits));
+
+  const CFINT* keys = &packed[CROSSING_OFFSET];
+  for (int i = 0; i < packed[4]; i++) {
+    // the edges of a key are not necessarily in order
+    int pair = tables.keyPair[packCrossing(keys[i] >> 6, keys[i] & 077)];
+    assert(pair >= 0);
+    bits[pair / 64] |= 1ULL << (pair % 64);
+  }
+}
+
+void CrossingSet::keepVertices(unsigned vertexSetN, unsigned vertexSetK) {
+  const uint64_t* maskN = tables.keepN[vertexSetN & ((1u << MAXN) - 1)];
+  const uint64_t* maskK = tables.keepK[vertexSetK & ((1u << MAXK) - 1)];
+  for (int w = 0; w < CROSSINGSET_WORDS; w++)
+    bits[w] &= maskN[w] & maskK[w];
+}
+
+void CrossingSet::relabel(const CFINT* newIndexN, const CFINT* newIndexK) {
+  uint64_t newBits[CROSSINGSET_WORDS];
+  memset(newBits, 0, sizeof(newBits));
+
+  for (int w = 0; w < CROSSINGSET_WORDS; w++)
+    for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+      CFINT cr[4];
+      unpack_crossing_key(tables.pairKey[64 * w + __builtin_ctzll(word)], cr);
+      if (newIndexN != NULL) {
+        cr[0] = newIndexN[cr[0]];
+        cr[2] = newIndexN[cr[2]];
+      }
+      if (newIndexK != NULL) {
+        cr[1] = newIndexK[cr[1]];
+        cr[3] = newIndexK[cr[3]];
+      }
+      int pair = tables.keyPair[packCrossing(packEdge(cr[0], cr[1]), packEdge(cr[2], cr[3]))];
+      newBits[pair / 64] |= 1ULL << (pair % 64);
+    }
+
+  memcpy(bits, newBits, sizeof(bits));
+}
+
+void CrossingSet::setShape(int N, int K, int Nlabelled, int Klabelled) {
+  this->N = N;
+  this->K = K;
+  this->Nlabelled = Nlabelled;
+  this->Klabelled = Klabelled;
+}
+
+Configuration CrossingSet::toConfiguration() const {
+  CFINT packed[CROSSING_OFFSET + crossingCount()];
+  packed[0] = N;
+  packed[1] = K;
+  packed[2] = Nlabelled;
+  packed[3] = Klabelled;
+
+  int count = 0;
+  for (int w = 0; w < CROSSINGSET_WORDS; w++)
+    for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+      packed[CROSSING_OFFSET + count++] = tables.pairKey[64 * w + __builtin_ctzll(word)];
+  packed[4] = count;
+
+  SANITY_CHECK_PACKED(packed);
+  return Configuration(ConfigurationView(packed));
+}
+
+int CrossingSet::crossingCount() const {
+  int count = 0;
+  for (int w = 0; w < CROSSINGSET_WORDS; w++)
+    count += __builtin_popcountll(bits[w]);
+  return count;
+}
+
+std::size_t CrossingSet::hash_value() const {
+  uint64_t hash = ((uint64_t) N << 24) | ((uint64_t) K << 16) | ((uint64_t) Nlabelled << 8) | (uint64_t) Klabelled;
+  for (int w = 0; w < CROSSINGSET_WORDS; w++) {
+    hash ^= bits[w];
+    hash *= 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 29;
+  }
+  return (std::size_t) hash;
+}
+
+int CrossingSet::shapePairCount(int N, int K) {
+  return N * (N - 1) / 2 * K * (K - 1);
+}
+
+/* Gathering the bits of a shape is a parallel bit extract (pext) per
+   word with the mask of the shape. Processors with BMI2 do this in one
+   instruction; otherwise the bits of the mask are visited one by one. */
+
+typedef uint32_t (*ShapeIndexFunction)(const uint64_t* bits, const uint64_t* mask);
+
+static uint32_t shape_index_scalar(const uint64_t* bits, const uint64_t* mask) {
+  uint32_t index = 0;
+  int position = 0;
+  for (int w = 0; w < CROSSINGSET_WORDS; w++)
+    for (uint64_t m = mask[w]; m != 0; m &= m - 1, position++)
+      if (bits[w] & m & (~m + 1))
+        index |= 1u << position;
+  return index;
+}
+
+#ifdef CROSSINGSET_BMI2
+__attribute__((target("bmi2,popcnt")))
+static uint32_t shape_index_bmi2(const uint64_t* bits, const uint64_t* mask) {
+  uint64_t index = 0;
+  int position = 0;
+  for (int w = 0; w < CROSSINGSET_WORDS; w++) {
+    index |= _pext_u64(bits[w], mask[w]) << position;
+    position += __builtin_popcountll(mask[w]);
+  }
+  return (uint32_t) index;
+}
+#endif
+
+struct ShapeIndexDispatch {
+  ShapeIndexFunction function;
+
+  ShapeIndexDispatch() {
+    function = shape_index_scalar;
+#ifdef CROSSINGSET_BMI2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2"))
+      function = shape_index_bmi2;
+#endif
+  }
+};
+
+static const ShapeIndexDispatch shapeIndexDispatch;
+
+uint32_t CrossingSet::shapeIndex(int N, int K) const {
+  assert(shapePairCount(N, K) <= 32);
+
+  uint64_t mask[CROSSINGSET_WORDS];
+  const uint64_t* maskN = tables.keepN[(1u << N) - 1];
+  const uint64_t* maskK = tables.keepK[(1u << K) - 1];
+  for (int w = 0; w < CROSSINGSET_WORDS; w++) {
+    mask[w] = maskN[w] & maskK[w];
+    // there are no crossings outside the shape
+    assert((bits[w] & ~mask[w]) == 0);
+  }
+
+  return shapeIndexDispatch.function(bits, mask);
+}
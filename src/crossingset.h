@@ -0,0 +1,93 @@
+#ifndef __CROSSINGSET_H__
+#define __CROSSINGSET_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "configuration.h"
+#include "turan.h"
+
+// Two edges can only cross if they have different top vertices and
+// different bottom vertices, so a drawing is determined by a subset of
+// the C(MAXN,2) * MAXK * (MAXK-1) pairs of such edges.
+#define CROSSINGSET_PAIRS (MAXN * (MAXN - 1) / 2 * MAXK * (MAXK - 1))
+#define CROSSINGSET_WORDS ((CROSSINGSET_PAIRS + 63) / 64)
+
+// A configuration stored as a bitset over the pairs of edges that can
+// cross, with one bit per pair. This is an alternative to the packed
+// vector of a Configuration for code that restricts and relabels the
+// same configuration many times: deleting vertices is an AND with a
+// precomputed mask, comparing and hashing touch a fixed number of words,
+// and relabelling looks up every crossing in a precomputed table of
+// pairs.
+//
+// The pairs are numbered in the order of their crossing keys (see
+// brickvector.h), so that walking through the set bits gives the
+// crossings in sorted order.
+class CrossingSet {
+ private:
+  CFINT N, K, Nlabelled, Klabelled;
+  uint64_t bits[CROSSINGSET_WORDS];
+ public:
+  CrossingSet();
+  CrossingSet(const Configuration& config);
+  CrossingSet(const ConfigurationView& view);
+
+  // sets the configuration to the given packed vector
+  void assign(const CFINT* packed);
+
+  // deletes the crossings of all edges that have an endpoint outside the
+  // given sets of vertices (bit v of vertexSetN stands for top vertex v);
+  // the vertices keep their indices
+  void keepVertices(unsigned vertexSetN, unsigned vertexSetK);
+
+  // replaces top vertex v by newIndexN[v] and bottom vertex v by
+  // newIndexK[v]; either array may be NULL to leave that side as it is
+  void relabel(const CFINT* newIndexN, const CFINT* newIndexK);
+
+  void setShape(int N, int K, int Nlabelled, int Klabelled);
+
+  // converts back into a configuration (with sorted crossings)
+  Configuration toConfiguration() const;
+
+  // the pairs of edges that can cross in a configuration with N top and K
+  // bottom vertices
+  static int shapePairCount(int N, int K);
+
+  // numbers the crossing sets of configurations with N top and K bottom
+  // vertices 0, ..., 2^shapePairCount(N, K) - 1, by gathering the bits of
+  // the pairs in that shape; at most 32 pairs
+  uint32_t shapeIndex(int N, int K) const;
+
+  int crossingCount() const;
+  int getN() const {
+    return N;
+  }
+  int getK() const {
+    return K;
+  }
+  int getNlabelled() const {
+    return Nlabelled;
+  }
+  int getKlabelled() const {
+    return Klabelled;
+  }
+
+  bool equals(const CrossingSet& rhs) const {
+    return (N == rhs.N) && (K == rhs.K) && (Nlabelled == rhs.Nlabelled) && (Klabelled == rhs.Klabelled)
+           && (memcmp(bits, rhs.bits, sizeof(bits)) == 0);
+  }
+  std::size_t hash_value() const;
+};
+
+inline bool operator==(const CrossingSet& a, const CrossingSet& b) {
+  return a.equals(b);
+}
+
+struct crossingset_hash {
+  std::size_t operator() (const CrossingSet& x) const {
+    return x.hash_value();
+  }
+};
+
+#endif // __CROSSINGSET_H__
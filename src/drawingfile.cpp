@@ -0,0 +1,196 @@
+#include <string.h>
+
+#include "drawingfile.h"
+#include "brickvector.h"
+
+/* Reading */
+
+DrawingReader::DrawingReader() {
+  binary = false;
+  position = NULL;
+  line = 0;
+  count = -1;
+  nextIndex = 0;
+  vectors = NULL;
+  offsets = NULL;
+}
+
+DrawingReader::~DrawingReader() {
+  close();
+}
+
+bool DrawingReader::open(const std::string& fileName) {
+  close();
+  this->fileName = fileName;
+
+  if (!file.open(fileName))
+    return false;
+  const char* data = file.begin();
+  size_t length = file.size();
+
+  binary = (length >= sizeof(DrawingFileHeader)) && (memcmp(data, DRAWINGFILE_MAGIC, 8) == 0);
+  if (!binary) {
+    position = data;
+    line = 1;
+    return true;
+  }
+
+  const DrawingFileHeader* header = (const DrawingFileHeader*) data;
+  if (header->version != DRAWINGFILE_VERSION)
+    fatal_error("Drawing file " << fileName << " has version " << header->version
+                << ", but version " << DRAWINGFILE_VERSION << " is expected.");
+  if ((header->indexOffset % sizeof(uint32_t) != 0) || (header->indexOffset < sizeof(DrawingFileHeader))
+      || (header->indexOffset + sizeof(uint32_t) * ((uint64_t) header->count + 1) != length))
+    fatal_error("Drawing file " << fileName << " is damaged.");
+
+  count = header->count;
+  nextIndex = 0;
+  vectors = (const CFINT*) (data + sizeof(DrawingFileHeader));
+  offsets = (const uint32_t*) (data + header->indexOffset);
+  if (sizeof(DrawingFileHeader) + sizeof(CFINT) * (uint64_t) offsets[count] > header->indexOffset)
+    fatal_error("Drawing file " << fileName << " is damaged.");
+  return true;
+}
+
+void DrawingReader::close() {
+  file.close();
+  binary = false;
+  count = -1;
+}
+
+// Reads the next (possibly negative) integer of a text file; returns
+// false at the end of the file
+bool DrawingReader::readInteger(int& value) {
+  const char* end = file.end();
+  while ((position < end) && ((*position == ' ') || (*position == '\t') || (*position == '\r') || (*position == '\n'))) {
+    if (*position == '\n')
+      line++;
+    position++;
+  }
+  if (position == end)
+    return false;
+
+  bool negative = (*position == '-');
+  if (negative)
+    position++;
+  if ((position == end) || (*position < '0') || (*position > '9'))
+    fatal_error("Unexpected character in drawing file " << fileName << " on line " << line << ".");
+
+  value = 0;
+  while ((position < end) && (*position >= '0') && (*position <= '9'))
+    value = 10 * value + (*position++ - '0');
+  if (negative)
+    value = -value;
+  return true;
+}
+
+const CFINT* DrawingReader::next() {
+  if (binary) {
+    if (nextIndex >= count)
+      return NULL;
+    return (*this)[nextIndex++];
+  }
+
+  if (file.begin() == NULL)
+    return NULL;
+
+  // read N, K, Nlabelled, Klabelled and the number of crossings
+  int number;
+  for (int i = 0; i < CROSSING_OFFSET; i++) {
+    if (!readInteger(number)) {
+      if (i == 0)
+        return NULL;
+      fatal_error("Drawing file " << fileName << " ends in the middle of a drawing.");
+    }
+    buffer[i] = static_cast<CFINT>(number);
+  }
+
+  // check that the number of crossings is not outrageous
+  int crossingCount = buffer[4];
+  if ((crossingCount < 0) || (crossingCount > DRAWING_MAX_CROSSINGS))
+    fatal_error("Trying to read a drawing with more than " << DRAWING_MAX_CROSSINGS
+                << " crossings from " << fileName << " (line " << line << "). Something must be wrong!");
+
+  // read the crossings and pack them one at a time
+  for (int i = 0; i < crossingCount; i++) {
+    CFINT cr[4];
+    for (int j = 0; j < 4; j++) {
+      if (!readInteger(number))
+        fatal_error("Drawing file " << fileName << " ends in the middle of a drawing.");
+      cr[j] = static_cast<CFINT>(number);
+    }
+    buffer[CROSSING_OFFSET + i] = crossing_key(cr);
+  }
+
+  return buffer;
+}
+
+/* Writing */
+
+DrawingWriter::DrawingWriter() {
+  file = NULL;
+  binary = false;
+}
+
+DrawingWriter::~DrawingWriter() {
+  if (file != NULL)
+    close();
+}
+
+bool DrawingWriter::open(const std::string& fileName, bool binary) {
+  this->binary = binary;
+  this->offsets.clear();
+  file = fopen(fileName.c_str(), binary ? "wb" : "w");
+  if (file == NULL)
+    return false;
+
+  // the header is written again when the file is closed
+  if (binary) {
+    DrawingFileHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, file);
+    offsets.push_back(0);
+  }
+  return true;
+}
+
+void DrawingWriter::add(const CFINT* packed) {
+  if (binary) {
+    int length = getPackedLength(packed);
+    fwrite(packed, sizeof(CFINT), length, file);
+    offsets.push_back(offsets.back() + length);
+    return;
+  }
+
+  CFINT vector[getLength(packed)];
+  unpack_vector(packed, vector);
+  for (int i = 0; i < getLength(vector); i++)
+    fprintf(file, "%d ", (int) vector[i]);
+  fputc('\n', file);
+}
+
+bool DrawingWriter::close() {
+  bool success = true;
+  if (binary) {
+    // pad the vectors so that the index is aligned
+    uint64_t indexOffset = sizeof(DrawingFileHeader) + sizeof(CFINT) * (uint64_t) offsets.back();
+    while (indexOffset % sizeof(uint32_t) != 0) {
+      fputc(0, file);
+      indexOffset++;
+    }
+    fwrite(&offsets[0], sizeof(uint32_t), offsets.size(), file);
+
+    DrawingFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DRAWINGFILE_MAGIC, 8);
+    header.version = DRAWINGFILE_VERSION;
+    header.count = offsets.size() - 1;
+    header.indexOffset = indexOffset;
+    success = (fseek(file, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, file) == 1);
+  }
+
+  success = !ferror(file) && success;
+  success = (fclose(file) == 0) && success;
+  file = NULL;
+  return success;
+}
@@ -0,0 +1,119 @@
+#ifndef __DRAWINGFILE_H__
+#define __DRAWINGFILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "brickvector.h"
+#include "mappedfile.h"
+#include "turan.h"
+
+// Drawings with more crossings than this are rejected as reading errors
+#define DRAWING_MAX_CROSSINGS 120
+
+/* Drawings are stored in one of two formats.
+
+   A text drawing file (drNK.txt) has one drawing per line, as a brick
+   vector: N, K, Nlabelled, Klabelled, the number of crossings and four
+   entries per crossing, each followed by a space.
+
+   A binary drawing file (drNK.bin) starts with a DrawingFileHeader. It is
+   followed by the drawings as packed vectors (see brickvector.h), one
+   after the other, and at indexOffset by count + 1 offsets (in CFINTs,
+   from the end of the header) of the drawings and of the end of the last
+   one. */
+
+#define DRAWINGFILE_MAGIC   "TURANDRW"
+#define DRAWINGFILE_VERSION 1
+
+struct DrawingFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t indexOffset;
+};
+
+// Reads the drawings of a text or binary drawing file; the format is
+// recognized by the header. The file is memory-mapped and only read as
+// far as the drawings are requested, so that large files are streamed.
+// The drawings of a binary file are returned in place, without copying.
+class DrawingReader {
+ private:
+  std::string fileName;
+  MappedFile file;
+  bool binary;
+
+  // text files: the position of the next drawing and its line number
+  const char* position;
+  int line;
+  CFINT buffer[CROSSING_OFFSET + DRAWING_MAX_CROSSINGS];
+
+  // binary files
+  int count, nextIndex;
+  const CFINT* vectors;
+  const uint32_t* offsets;
+
+  bool readInteger(int& value);
+
+  DrawingReader(const DrawingReader&);
+  DrawingReader& operator = (const DrawingReader&);
+
+ public:
+  DrawingReader();
+  ~DrawingReader();
+
+  // returns false if the file cannot be opened; ends the program if it is
+  // not a valid drawing file
+  bool open(const std::string& fileName);
+  void close();
+
+  bool isBinary() const {
+    return binary;
+  }
+
+  // a hash of the contents of the file, to tell whether it has changed
+  uint64_t checksum() const {
+    return file.checksum();
+  }
+
+  // returns the next drawing as a packed vector, or NULL if there are no
+  // more drawings. For text files the vector is overwritten by the next
+  // call; for binary files it stays valid until the file is closed.
+  const CFINT* next();
+
+  // the number of drawings and the drawing with a given index, for binary
+  // files only
+  int size() const {
+    return count;
+  }
+  const CFINT* operator[] (const int index) const {
+    return &vectors[offsets[index]];
+  }
+};
+
+// Writes drawings, given as packed vectors, to a text or binary drawing
+// file
+class DrawingWriter {
+ private:
+  FILE* file;
+  bool binary;
+  std::vector<uint32_t> offsets;
+
+  DrawingWriter(const DrawingWriter&);
+  DrawingWriter& operator = (const DrawingWriter&);
+
+ public:
+  DrawingWriter();
+  ~DrawingWriter();
+
+  bool open(const std::string& fileName, bool binary);
+  void add(const CFINT* packed);
+
+  // writes the index of a binary file; returns false if anything could
+  // not be written
+  bool close();
+};
+
+#endif // __DRAWINGFILE_H__
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <string.h>
+#include <stddef.h>
+
+#include "flagstore.h"
+#include "brickvector.h"
+
+FlagStore::FlagStore() {
+  clear();
+}
+
+void FlagStore::clear() {
+  arena.clear();
+  offsets.clear();
+  flagData = NULL;
+  flagOffsets = NULL;
+  count = 0;
+  external = false;
+}
+
+int FlagStore::add(const Configuration& config) {
+  assert(!external);
+  const CFINT* packed = config.packedVector();
+  offsets.push_back(arena.size());
+  arena.insert(arena.end(), packed, packed + getPackedLength(packed));
+
+  // the vectors may have moved
+  flagData = &arena[0];
+  flagOffsets = &offsets[0];
+  return count++;
+}
+
+/* The flags are written as the number of flags and the length of the
+   arena (as 32-bit integers), the offsets and the arena. */
+
+void FlagStore::write(std::ostream& stream) const {
+  uint32_t header[2] = { (uint32_t) count, (uint32_t) (count > 0 ? flagOffsets[count - 1] + getPackedLength((*this)[count - 1].packedVector()) : 0) };
+  stream.write((const char*) header, sizeof(header));
+  stream.write((const char*) flagOffsets, sizeof(int) * count);
+  stream.write((const char*) flagData, sizeof(CFINT) * header[1]);
+}
+
+const char* FlagStore::attach(const char* data, const char* end) {
+  clear();
+
+  uint32_t header[2];
+  if (end - data < (ptrdiff_t) sizeof(header))
+    return NULL;
+  memcpy(header, data, sizeof(header));
+  data += sizeof(header);
+
+  if ((uint64_t) (end - data) < sizeof(int) * (uint64_t) header[0] + sizeof(CFINT) * (uint64_t) header[1])
+    return NULL;
+
+  // the flags must follow each other in the arena, starting at its
+  // beginning, and every flag must end before the next one starts
+  const int* fileOffsets = (const int*) data;
+  const CFINT* fileData = (const CFINT*) (data + sizeof(int) * header[0]);
+  if ((header[0] > 0) && (fileOffsets[0] != 0))
+    return NULL;
+  for (uint32_t i = 0; i < header[0]; i++) {
+    uint32_t next = (i + 1 < header[0]) ? (uint32_t) fileOffsets[i + 1] : header[1];
+    if ((fileOffsets[i] < 0) || ((uint32_t) fileOffsets[i] >= header[1]) || (next < (uint32_t) fileOffsets[i])
+        || (next - fileOffsets[i] < CROSSING_OFFSET))
+      return NULL;
+    const CFINT* packed = &fileData[fileOffsets[i]];
+    if ((getCrossingCount(packed) < 0) || (getPackedLength(packed) > (int) (next - fileOffsets[i])))
+      return NULL;
+  }
+
+  flagOffsets = fileOffsets;
+  flagData = fileData;
+  count = header[0];
+  external = true;
+  return data + sizeof(int) * header[0] + sizeof(CFINT) * header[1];
+}
+
+#define FLAGINDEX_INITIAL_SLOTS 64
+
+FlagIndex::FlagIndex(const FlagStore* flags) {
+  this->flags = flags;
+  clear();
+}
+
+void FlagIndex::clear() {
+  Slot empty = { -1, 0 };
+  slots.assign(FLAGINDEX_INITIAL_SLOTS, empty);
+  count = 0;
+}
+
+// Puts a flag index in the first free slot of its probe sequence
+void FlagIndex::place(int index, uint64_t hash) {
+  size_t mask = slots.size() - 1;
+  size_t slot = hash & mask;
+  while (slots[slot].index >= 0)
+    slot = (slot + 1) & mask;
+  slots[slot].index = index;
+  slots[slot].fingerprint = (uint32_t) (hash >> 32);
+}
+
+void FlagIndex::grow() {
+  std::vector<Slot> old;
+  old.swap(slots);
+
+  Slot empty = { -1, 0 };
+  slots.assign(old.size() * 2, empty);
+  for (size_t i = 0; i < old.size(); i++)
+    if (old[i].index >= 0)
+      place(old[i].index, packed_vector_hash64((*flags)[old[i].index].packedVector()));
+}
+
+void FlagIndex::insert(int index) {
+  if (2 * (count + 1) > (int) slots.size())
+    grow();
+  place(index, packed_vector_hash64((*flags)[index].packedVector()));
+  count++;
+}
+
+int FlagIndex::find(const CFINT* packed) const {
+  uint64_t hash = packed_vector_hash64(packed);
+  uint32_t fingerprint = (uint32_t) (hash >> 32);
+
+  size_t mask = slots.size() - 1;
+  for (size_t slot = hash & mask; slots[slot].index >= 0; slot = (slot + 1) & mask)
+    if ((slots[slot].fingerprint == fingerprint)
+        && packed_vectors_equals((*flags)[slots[slot].index].packedVector(), packed))
+      return slots[slot].index;
+
+  return -1;
+}
+
+/* Frozen index */
+
+#define FROZEN_FLAGS_PER_BUCKET 4
+#define FROZEN_MAX_SEED 0x1000000
+#define FROZEN_MAGIC 0x4d50484655524154ULL
+
+// MurmurHash3 finalizer
+static inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// The checksum of a store combines the hashes of its flags in order
+static uint64_t store_checksum(const FlagStore& flags, std::vector<uint64_t>& hashes) {
+  uint64_t checksum = flags.size();
+  hashes.resize(flags.size());
+  for (int i = 0; i < flags.size(); i++) {
+    hashes[i] = packed_vector_hash64(flags[i].packedVector());
+    checksum = mix64(checksum ^ hashes[i]);
+  }
+  return checksum;
+}
+
+FrozenFlagIndex::FrozenFlagIndex(const FlagStore* flags) {
+  this->flags = flags;
+  clear();
+}
+
+void FrozenFlagIndex::clear() {
+  count = 0;
+  checksum = 0;
+  seeds.clear();
+  slotFlag.clear();
+}
+
+// bucket and slot are taken from different bits of the hash, scaled to
+// their range by a multiplication instead of a division
+inline int FrozenFlagIndex::bucketOf(uint64_t hash) const {
+  return (int) (((hash >> 32) * (uint64_t) seeds.size()) >> 32);
+}
+
+inline int FrozenFlagIndex::slotOf(uint64_t hash, uint32_t seed) const {
+  return (int) (((mix64(hash + seed * 0x9E3779B97F4A7C15ULL) & 0xFFFFFFFFULL) * (uint64_t) count) >> 32);
+}
+
+bool FrozenFlagIndex::build() {
+  clear();
+  int n = flags->size();
+  if (n == 0)
+    return false;
+
+  std::vector<uint64_t> hashes;
+  uint64_t newChecksum = store_checksum(*flags, hashes);
+
+  count = n;
+  seeds.assign(n / FROZEN_FLAGS_PER_BUCKET + 1, 0);
+  slotFlag.assign(n, -1);
+
+  // group the flags by bucket
+  int bucketCount = seeds.size();
+  std::vector<int> bucketStart(bucketCount + 1, 0), members(n);
+  for (int i = 0; i < n; i++)
+    bucketStart[bucketOf(hashes[i]) + 1]++;
+  for (int b = 0; b < bucketCount; b++)
+    bucketStart[b + 1] += bucketStart[b];
+  std::vector<int> position(bucketStart.begin(), bucketStart.end() - 1);
+  for (int i = 0; i < n; i++)
+    members[position[bucketOf(hashes[i])]++] = i;
+
+  // place the largest buckets first, while most slots are free
+  std::vector<std::pair<int, int> > order(bucketCount);
+  for (int b = 0; b < bucketCount; b++)
+    order[b] = std::make_pair(-(bucketStart[b + 1] - bucketStart[b]), b);
+  std::sort(order.begin(), order.end());
+
+  std::vector<int> slots;
+  for (int o = 0; o < bucketCount; o++) {
+    int b = order[o].second;
+    int first = bucketStart[b], size = bucketStart[b + 1] - first;
+    if (size == 0)
+      break;
+
+    uint32_t seed = 0;
+    for (; seed < FROZEN_MAX_SEED; seed++) {
+      slots.clear();
+      bool fits = true;
+      for (int k = 0; (k < size) && fits; k++) {
+        int slot = slotOf(hashes[members[first + k]], seed);
+        fits = (slotFlag[slot] < 0) && (std::find(slots.begin(), slots.end(), slot) == slots.end());
+        slots.push_back(slot);
+      }
+      if (fits)
+        break;
+    }
+
+    // no seed separates the bucket, which happens if two flags have the
+    // same hash
+    if (seed == FROZEN_MAX_SEED) {
+      clear();
+      return false;
+    }
+
+    seeds[b] = seed;
+    for (int k = 0; k < size; k++)
+      slotFlag[slots[k]] = members[first + k];
+  }
+
+  checksum = newChecksum;
+  return true;
+}
+
+int FrozenFlagIndex::find(const CFINT* packed) const {
+  uint64_t hash = packed_vector_hash64(packed);
+  int flag = slotFlag[slotOf(hash, seeds[bucketOf(hash)])];
+  if (packed_vectors_equals((*flags)[flag].packedVector(), packed))
+    return flag;
+  return -1;
+}
+
+void FrozenFlagIndex::write(std::ostream& stream) const {
+  uint64_t magic = FROZEN_MAGIC;
+  uint32_t header[2] = { (uint32_t) count, (uint32_t) seeds.size() };
+  stream.write((const char*) &magic, sizeof(magic));
+  stream.write((const char*) &checksum, sizeof(checksum));
+  stream.write((const char*) header, sizeof(header));
+  if (count > 0) {
+    stream.write((const char*) &seeds[0], sizeof(uint32_t) * seeds.size());
+    stream.write((const char*) &slotFlag[0], sizeof(int) * slotFlag.size());
+  }
+}
+
+bool FrozenFlagIndex::read(std::istream& stream) {
+  clear();
+
+  uint64_t magic, storedChecksum;
+  uint32_t header[2];
+  stream.read((char*) &magic, sizeof(magic));
+  stream.read((char*) &storedChecksum, sizeof(storedChecksum));
+  stream.read((char*) header, sizeof(header));
+  if (!stream || (magic != FROZEN_MAGIC) || ((int) header[0] != flags->size()) || (header[0] == 0)
+      || (header[1] != header[0] / FROZEN_FLAGS_PER_BUCKET + 1))
+    return false;
+
+  std::vector<uint64_t> hashes;
+  if (store_checksum(*flags, hashes) != storedChecksum)
+    return false;
+
+  count = header[0];
+  seeds.resize(header[1]);
+  slotFlag.resize(count);
+  stream.read((char*) &seeds[0], sizeof(uint32_t) * seeds.size());
+  stream.read((char*) &slotFlag[0], sizeof(int) * slotFlag.size());
+  bool valid = !stream.fail();
+
+  // the checksum only covers the flags, so the index itself is checked:
+  // the seeds and slots must be in range, and every flag must be found in
+  // its own slot
+  for (int b = 0; valid && (b < seeds.size()); b++)
+    valid = (seeds[b] < FROZEN_MAX_SEED);
+  for (int slot = 0; valid && (slot < count); slot++)
+    valid = (slotFlag[slot] >= 0) && (slotFlag[slot] < count);
+  for (int i = 0; valid && (i < count); i++)
+    valid = (slotFlag[slotOf(hashes[i], seeds[bucketOf(hashes[i])])] == i);
+
+  if (!valid) {
+    clear();
+    return false;
+  }
+
+  checksum = storedChecksum;
+  return true;
+}
@@ -0,0 +1,128 @@
+#ifndef __FLAGSTORE_H__
+#define __FLAGSTORE_H__
+
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+#include "configuration.h"
+#include "turan.h"
+
+// The flags of an algebra, stored one after the other as packed vectors
+// in a single array. A flag is identified by its index; operator[] gives
+// a view of its packed vector, which stays valid until the next flag is
+// added.
+//
+// Instead of holding the flags itself, a store can also refer to flags
+// written by write() that are in memory elsewhere, such as in a mapped
+// file; no flags can be added to such a store.
+class FlagStore {
+ private:
+  std::vector<CFINT> arena;
+  std::vector<int> offsets;
+
+  // the flags in use: those in arena and offsets, or elsewhere
+  const CFINT* flagData;
+  const int* flagOffsets;
+  int count;
+  bool external;
+ public:
+  FlagStore();
+  void clear();
+
+  // appends a flag and returns its index
+  int add(const Configuration& config);
+
+  int size() const {
+    return count;
+  }
+
+  ConfigurationView operator[] (const int index) const {
+    return ConfigurationView(&flagData[flagOffsets[index]]);
+  }
+
+  // writes the flags in binary form, starting at an offset that is a
+  // multiple of four
+  void write(std::ostream& stream) const;
+
+  // uses the flags written by write() at data, which must stay in memory
+  // as long as the store is used; returns the end of the flags, or NULL
+  // if they do not fit before end
+  const char* attach(const char* data, const char* end);
+};
+
+// Maps packed vectors to the indices of the flags in a FlagStore. This is
+// an open-addressing hash table with linear probing: every slot holds a
+// flag index and the upper 32 bits of the flag's 64-bit hash, and a probe
+// only compares the vectors themselves when these fingerprints agree. The
+// table is kept at most half full.
+class FlagIndex {
+ private:
+  struct Slot {
+    int index;            // flag index, or -1 for an empty slot
+    uint32_t fingerprint;
+  };
+
+  const FlagStore* flags;
+  std::vector<Slot> slots;
+  int count;
+
+  void grow();
+  void place(int index, uint64_t hash);
+
+ public:
+  FlagIndex(const FlagStore* flags);
+
+  void clear();
+
+  // adds the flag with the given index, which must not be in the table yet
+  void insert(int index);
+
+  // returns the index of the flag with the given packed vector, or -1
+  int find(const CFINT* packed) const;
+
+  int size() const {
+    return count;
+  }
+};
+
+// A minimal perfect hash over the flags of a FlagStore that no longer
+// changes. The flags are spread over buckets by their 64-bit hash, and
+// every bucket has a seed that sends its flags to distinct slots of a
+// table with exactly one slot per flag (hash and displace). A lookup
+// therefore costs one hash, one table entry and one comparison of packed
+// vectors, without probing.
+class FrozenFlagIndex {
+ private:
+  const FlagStore* flags;
+  int count;
+  uint64_t checksum;
+  std::vector<uint32_t> seeds;
+  std::vector<int> slotFlag;
+
+  int bucketOf(uint64_t hash) const;
+  int slotOf(uint64_t hash, uint32_t seed) const;
+
+ public:
+  FrozenFlagIndex(const FlagStore* flags);
+
+  void clear();
+  bool isBuilt() const {
+    return count > 0;
+  }
+
+  // builds the hash over all flags in the store; returns false (and
+  // leaves the index empty) if two flags have the same 64-bit hash
+  bool build();
+
+  // returns the index of the flag with the given packed vector, or -1
+  int find(const CFINT* packed) const;
+
+  // writes the index in binary form; read returns false, and leaves the
+  // index empty, unless the stream holds an index for exactly the flags
+  // in the store
+  void write(std::ostream& stream) const;
+  bool read(std::istream& stream);
+};
+
+#endif // __FLAGSTORE_H__
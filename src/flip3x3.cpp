@@ -13,8 +13,10 @@
 #include "lex_sort.h"
 
 #include "app_path.h"
+#include "threads.h"
 #include "brickalgebra.h"
 #include "cauchyschwarzmatrix.h"
+#include "restrictiontable.h"
 
 #define FILENAME "parameters.txt"
 
@@ -31,6 +33,7 @@ int toInt(string str) {
 
 int main(int argc, char* argv[]) {
   set_argv0(argv[0]);
+  parse_thread_options(argc, argv);
 
   /* Read parameter file */
   string line;
@@ -59,67 +62,31 @@ int main(int argc, char* argv[]) {
 
 
   /* Construct variable brick algebra */
-  BrickAlgebra algebra3x3(3, 3, 0, 0);
-  algebra3x3.constructElements();
+  const BrickAlgebra& algebra3x3 = BrickAlgebra::shared(3, 3, 0, 0);
 
 
   /* For each flag in the variable algebra, count the 3x3 flags contained in it */
-  BrickAlgebra variables(N, K, 0, 0);
-  variables.constructElements();
+  const BrickAlgebra& variables = BrickAlgebra::shared(N, K, 0, 0);
 
   std::vector< std::map<int, int> > subFlagCounts(algebra3x3.size());
-  const std::vector<Configuration> & flagList = variables.getFlagList();
 
-  // construct sets seqN = {0, ..., N-1} and seqK = {0, ..., K-1}
-  CFINT seqN[N];
-  for (int i = 0; i < N; i++) seqN[i] = i;
-  CFINT seqK[K];
-  for (int i = 0; i < K; i++) seqK[i] = i;
+  // the 3x3 subflags of a flag are its restrictions to 3x3 flags without
+  // labelled vertices, one for each choice of vertices
+  const RestrictionTable& restrictions = RestrictionTable::shared(N, K, 3, 3, 0, 0);
 
   int flagCount = 0;
   for (int F = 0; F < variables.size(); F++) {
-    // generate all ordered subsets vertN of seqN = {0, ..., N-1}
-    CFINT vertN[3];
-    subsetBuffer<CFINT> bufferN(seqN, N, 3);
-
-    while (nextSubset(vertN, bufferN)) {
-      // generate all subsets vertK of seqK = {0, ..., K-1}
-      CFINT vertK[3];
-      subsetBuffer<CFINT> bufferK(seqK, K, 3);
-      while (nextSubset(vertK, bufferK)) {
-        CFINT newIndexN[N], newIndexK[K];
-
-        for (int i = 0; i < N; i++) newIndexN[i] = -1;
-        for (int i = 0; i < K; i++) newIndexK[i] = -1;
-
-        int iN = 0, iK = 0;
-        for (int i = 0; i < 3; i++)
-          newIndexN[vertN[i]] = iN++;
-        for (int i = 0; i < N; i++)
-          if (newIndexN[i] == -1)
-            newIndexN[i] = iN++;
-        for (int i = 0; i < 3; i++)
-          newIndexK[vertK[i]] = iK++;
-        for (int i = 0; i < K; i++)
-          if (newIndexK[i] == -1)
-            newIndexK[i] = iK++;
-        Configuration config = variables[F];
-        config.reindexN(newIndexN);
-        config.reindexK(newIndexK);
-        config.keepNvertices(3);
-        config.keepKvertices(3);
-        config.putInCanonicalForm(false);
-
-        int flagIndex = algebra3x3.getIndex(config);
-        if (flagIndex < 0)
-          fatal_error("Flag encountered that does not exist! This should not happen.");
-
-        map<int,int>::iterator entry = subFlagCounts[flagIndex].find(flagIndex);
-        if (entry == subFlagCounts[flagIndex].end())
-          subFlagCounts[flagIndex][F] = 1;
-        else
-          subFlagCounts[flagIndex][F] = entry->second + 1;
-      }
+    const int* subFlags = restrictions.restrictions(F, 0);
+    for (int slot = 0; slot < restrictions.slots(); slot++) {
+      int flagIndex = subFlags[slot];
+      if (flagIndex < 0)
+        fatal_error("Flag encountered that does not exist! This should not happen.");
+
+      map<int,int>::iterator entry = subFlagCounts[flagIndex].find(flagIndex);
+      if (entry == subFlagCounts[flagIndex].end())
+        subFlagCounts[flagIndex][F] = 1;
+      else
+        subFlagCounts[flagIndex][F] = entry->second + 1;
     }
   }
 
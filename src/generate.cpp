@@ -8,6 +8,7 @@
 
 #include "turan.h"
 #include "app_path.h"
+#include "threads.h"
 #include "brickalgebra.h"
 #include "cauchyschwarzmatrix.h"
 
@@ -51,10 +52,9 @@ void writeCrossingsM(const BrickAlgebra& variables) {
   crossingsFile << "   cr = [";
 
   // retrieve list of variables
-  const vector<Configuration> & flagList = variables.getFlagList();
-  vector<Configuration>::const_iterator flagIterator;
-  for (flagIterator = flagList.begin(); flagIterator < flagList.end(); ++flagIterator)
-    crossingsFile << flagIterator->crossingCount() << " ";
+  const FlagStore& flagList = variables.getFlagList();
+  for (int F = 0; F < flagList.size(); F++)
+    crossingsFile << flagList[F].crossingCount() << " ";
   crossingsFile << "];" << endl;
   crossingsFile.close();
   cout << "Done" << endl;
@@ -75,6 +75,7 @@ void writeParametersM(int N, int K, int nvar, int nmatrix) {
 
 int main(int argc, char* argv[]) {
   set_argv0(argv[0]);
+  parse_thread_options(argc, argv);
 
   string line;
   vector<string> entries;
@@ -100,8 +101,7 @@ int main(int argc, char* argv[]) {
   K = toInt(entries[1]);
 
   /* Construct variable brick algebra */
-  BrickAlgebra variables(N, K, 0, 0);
-  variables.constructElements();
+  const BrickAlgebra& variables = BrickAlgebra::shared(N, K, 0, 0);
 
   /* Read and construct Cauchy Schwarz matrices */
   vector<CauchySchwarzMatrix*> matrices;
@@ -203,15 +203,14 @@ int main(int argc, char* argv[]) {
   for (int F = 0; F < variables.size(); F++)
     for (int m = 0; m < matrices.size(); m++) {
       CauchySchwarzMatrix* M = matrices[m];
-      const boost::unordered_set<pair<int, int> >& list = M->getNonemptyEntries(F);
-      boost::unordered_set<pair<int, int> >::const_iterator it;
+      CauchySchwarzMatrix::EntryList list = M->getNonemptyEntries(F);
+      CauchySchwarzMatrix::EntryList::const_iterator it;
       for (it = list.begin(); it != list.end(); ++it) {
         int i = it->first;
         int j = it->second;
-        int factor = M->getFactor(i, j, F);
+        int factor = list.factor(it);
 
         if (factor == 0) continue;
-        if (i > j) continue;
 
         sdpa << (1+F) << " " << (1+m) << " "
              << (1+i) << " " << (1+j) << " "
@@ -1,40 +1,7 @@
-#include <iostream>
-#include <string.h>
+#include <algorithm>
 
 #include "lex_sort.h"
 
-// Swap two vectors
-inline void swap(CFINT* array1, CFINT* array2, int n) {
-  assert(n >= 0);
-  assert(array1 != NULL);
-  assert(array2 != NULL);
-
-  if (array1 == array2) return;
-
-  int diff = array1 - array2;
-  int vectorBytes = n * sizeof(CFINT);
-
-  // if the arrays don't overlap, swapping can be done
-  // with one temporary array
-  if ((diff <= -n) || (diff >= n)) {
-    CFINT temp[n];
-    memcpy(temp,   array1, vectorBytes);
-    memcpy(array1, array2, vectorBytes);
-    memcpy(array2, temp,   vectorBytes);
-  } else {
-    // otherwise, we "need" two. (notice that this case
-    // should not happen in the lexicographical sort
-    // algorithm)
-    CFINT temp1[n], temp2[n];
-    memcpy(temp1, array1, vectorBytes);
-    memcpy(temp2, array2, vectorBytes);
-
-    memcpy(array1, temp2, vectorBytes);
-    memcpy(array2, temp1, vectorBytes);
-  }
-}
-
-
 // Compare two vectors lexicographically
 int lex_compare(CFINT* a, CFINT* b, int length) {
   assert(length >= 0);
@@ -50,64 +17,73 @@ int lex_compare(CFINT* a, CFINT* b, int length) {
   return 0;
 }
 
-// sorts an array lexicographically
-void lex_sort(CFINT* vector, int n, int block_size) {
-  assert(vector != NULL);
-  assert(n >= 0);
-  assert(block_size >= 0);
 
-  if (n <= 1) return;
 
-  if (n == 2) { // for n = 2, sorting is easy
-    CFINT* block1 = vector;
-    CFINT* block2 = vector + block_size;
-    if (lex_compare(block1, block2, block_size) > 0)
-      swap(block1, block2, block_size);
-    return;
-  }
-
-  // choose pivot index for sort
-  int pivotIndex = (int) n / 2;
-
-  // move pivot element to end of list
-  CFINT* pivot_block= &vector[block_size * (n-1)];
-  swap(&vector[pivotIndex * block_size], pivot_block, block_size);
-
-  // partition entries
-  CFINT* block_i = vector;
-  CFINT* store_block = vector;
-  pivotIndex = 0;
-  for (int i = 0; i < n - 1; i++) {
-    if (lex_compare(block_i, pivot_block, block_size) < 0) {
-      swap(block_i, store_block, block_size);
-      store_block += block_size;
-      pivotIndex++;
+/* Sorting networks for up to SORTING_NETWORK_MAX keys. The network for n
+   keys is Batcher's odd-even merge sort for the next power of two, with
+   the comparators that involve positions n and higher removed: those
+   positions can be thought of as holding infinitely large keys, which
+   these comparators never move. */
+
+#define MAXCOMPARATORS 64
+
+struct SortingNetworks {
+  int size[SORTING_NETWORK_MAX + 1];
+  unsigned char comparators[SORTING_NETWORK_MAX + 1][MAXCOMPARATORS][2];
+
+  SortingNetworks() {
+    int width = 1;
+    while (width < SORTING_NETWORK_MAX)
+      width *= 2;
+
+    for (int n = 0; n <= SORTING_NETWORK_MAX; n++) {
+      size[n] = 0;
+      for (int p = 1; p < width; p *= 2)
+        for (int k = p; k >= 1; k /= 2)
+          for (int j = k % p; j + k < width; j += 2 * k)
+            for (int i = 0; i < k; i++)
+              if ((i + j) / (2 * p) == (i + j + k) / (2 * p) && (i + j + k < n)) {
+                assert(size[n] < MAXCOMPARATORS);
+                comparators[n][size[n]][0] = i + j;
+                comparators[n][size[n]][1] = i + j + k;
+                size[n]++;
+              }
     }
-    block_i += block_size;
   }
-
-  swap(store_block, pivot_block, block_size);
-  pivot_block = store_block;
-
-  // recursively sort the two parts
-  lex_sort(vector, pivotIndex, block_size);
-  lex_sort(&pivot_block[block_size], n - pivotIndex - 1, block_size);
-
-
-#ifdef DEBUG
-  // check that the resulting array is properly sorted
-  for (int i = 0; i < n - 1; i++) {
-    if (lex_compare(&vector[block_size * i], &vector[block_size * (i+1)], block_size) > 0) {
-      std::cerr << "Sorting algorithm failed!!" << std::endl;
-      for (int j = 0; j < n; j++) {
-        for (int k = 0; k < block_size; k++)
-          std::cerr << vector[block_size * j + k] << " ";
-        std::cerr << std::endl;
-      }
-    }
+};
+
+static SortingNetworks networks;
+
+// Radix sort of 12-bit keys in two passes of 6 bits
+static void radix_sort_keys(CFINT* keys, int n) {
+  CFINT buffer[n];
+  int count[65];
+
+  for (int shift = 0; shift < 12; shift += 6) {
+    CFINT* from = (shift == 0) ? keys : buffer;
+    CFINT* to   = (shift == 0) ? buffer : keys;
+
+    for (int b = 0; b <= 64; b++)
+      count[b] = 0;
+    for (int i = 0; i < n; i++)
+      count[((from[i] >> shift) & 63) + 1]++;
+    for (int b = 1; b <= 64; b++)
+      count[b] += count[b - 1];
+    for (int i = 0; i < n; i++)
+      to[count[(from[i] >> shift) & 63]++] = from[i];
   }
-#endif
 }
 
+void sort_crossing_keys(CFINT* keys, int n) {
+  if (n > SORTING_NETWORK_MAX) {
+    radix_sort_keys(keys, n);
+    return;
+  }
 
-
+  const unsigned char (*comparator)[2] = networks.comparators[n];
+  for (int c = 0; c < networks.size[n]; c++) {
+    CFINT a = keys[comparator[c][0]], b = keys[comparator[c][1]];
+    keys[comparator[c][0]] = std::min(a, b);
+    keys[comparator[c][1]] = std::max(a, b);
+  }
+}
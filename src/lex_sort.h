@@ -10,10 +10,31 @@
 //      0 if a = b.
 int lex_compare(CFINT* a, CFINT* b, int length);
 
-// This function lexicographically sorts an array in place. The input is
-// assumed to be contiguous and consisting of n vectors of length
-// block_size.
-void lex_sort(CFINT* vector, int n, int block_size);
+// Same as above, for vectors whose length is known at compile time. The
+// comparison is unrolled into a chain of conditionals.
+template <int length> struct LexCompare {
+  static inline int compare(const CFINT* a, const CFINT* b) {
+    if (*a < *b) return -1;
+    if (*a > *b) return 1;
+    return LexCompare<length - 1>::compare(a + 1, b + 1);
+  }
+};
+
+template <> struct LexCompare<0> {
+  static inline int compare(const CFINT*, const CFINT*) {
+    return 0;
+  }
+};
+
+template <int length> inline int lex_compare(const CFINT* a, const CFINT* b) {
+  return LexCompare<length>::compare(a, b);
+}
+
+// Sorts n packed crossing keys (non-negative 12-bit integers, see
+// brickvector.h) in increasing order. Up to SORTING_NETWORK_MAX keys are
+// sorted by a sorting network, longer lists by a radix sort.
+#define SORTING_NETWORK_MAX 16
+void sort_crossing_keys(CFINT* keys, int n);
 
 
 #endif // __LEX_SORT_H__
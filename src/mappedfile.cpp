@@ -0,0 +1,63 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "mappedfile.h"
+#include "turan.h"
+
+bool MappedFile::open(const std::string& fileName) {
+  close();
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // an empty file cannot be mapped
+  if (status.st_size > 0) {
+    void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fd);
+      fatal_error("Could not map file " << fileName << " into memory.");
+    }
+    madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+    data = (const char*) mapping;
+    length = status.st_size;
+  }
+
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close() {
+  if (data != NULL)
+    munmap((void*) data, length);
+  data = NULL;
+  length = 0;
+}
+
+// The file is hashed eight bytes at a time; every word is mixed in with a
+// multiplication and a shift
+uint64_t MappedFile::checksum() const {
+  uint64_t hash = length;
+  size_t words = length / 8;
+  for (size_t i = 0; i < words; i++) {
+    uint64_t word;
+    memcpy(&word, data + 8 * i, 8);
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 32;
+  }
+
+  uint64_t tail = 0;
+  if (length > 8 * words)
+    memcpy(&tail, data + 8 * words, length - 8 * words);
+  hash = (hash ^ tail) * 0x9E3779B97F4A7C15ULL;
+  return hash ^ (hash >> 32);
+}
@@ -0,0 +1,52 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <streambuf>
+#include <string>
+
+// A file that is mapped into memory for reading
+class MappedFile {
+ private:
+  const char* data;
+  size_t length;
+
+  MappedFile(const MappedFile&);
+  MappedFile& operator = (const MappedFile&);
+
+ public:
+  MappedFile() : data(NULL), length(0) { }
+  ~MappedFile() {
+    close();
+  }
+
+  // returns false if the file cannot be opened; an empty file is opened,
+  // but has no data
+  bool open(const std::string& fileName);
+  void close();
+
+  const char* begin() const {
+    return data;
+  }
+  const char* end() const {
+    return data + length;
+  }
+  size_t size() const {
+    return length;
+  }
+
+  // a 64-bit hash of the contents of the file
+  uint64_t checksum() const;
+};
+
+// A stream buffer that reads from a block of memory, such as a part of a
+// mapped file, so that it can be read with an std::istream
+class MemoryStreamBuffer : public std::streambuf {
+ public:
+  MemoryStreamBuffer(const char* begin, const char* end) {
+    setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+  }
+};
+
+#endif // __MAPPEDFILE_H__
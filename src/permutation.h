@@ -86,28 +86,86 @@ template <class T> bool advancePermutation(T* a, int start, int end) {
   return true;
 }
 
+// Fills table with the n!-1 adjacent transpositions that take the
+// Steinhaus-Johnson-Trotter ordering of the permutations of n elements
+// from one permutation to the next: the (i+1)'th permutation is obtained
+// from the i'th by swapping the elements at positions table[i] and
+// table[i]+1. Returns the number of transpositions.
+template <class T> int sjtTranspositions(T* table, int n) {
+  assert(n >= 0);
+
+  int perm[n], direction[n];
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+    direction[i] = -1;
+  }
+
+  int count = 0;
+  while (true) {
+    // find the largest mobile element, i.e. the largest element
+    // that is larger than the neighbour it is pointing at
+    int mobile = -1;
+    for (int i = 0; i < n; i++) {
+      int j = i + direction[perm[i]];
+      if ((j < 0) || (j >= n) || (perm[j] > perm[i]))
+        continue;
+      if ((mobile < 0) || (perm[i] > perm[mobile]))
+        mobile = i;
+    }
+    if (mobile < 0)
+      break;
+
+    // swap it with that neighbour, and reverse the direction of
+    // all larger elements
+    int element = perm[mobile];
+    int j = mobile + direction[element];
+    std::swap<int>(perm[mobile], perm[j]);
+    table[count++] = (T) std::min(mobile, j);
+
+    for (int i = element + 1; i < n; i++)
+      direction[i] = -direction[i];
+  }
+
+  return count;
+}
+
+// Sets of up to SUBSETBUFFER_INLINE elements are stored inside the buffer,
+// so that enumerating their subsets does not allocate memory
+#define SUBSETBUFFER_INLINE 16
+
 template <class T> struct subsetBuffer {
   int subset_size, elements_size;
   T* elements;
   T* index;
+  bool started;
+
+  T inlineElements[SUBSETBUFFER_INLINE];
+  T inlineIndex[SUBSETBUFFER_INLINE];
 
   subsetBuffer(T* elements, const int elements_size, const int subset_size) {
     this->subset_size = subset_size;
     this->elements_size = elements_size;
 
-    this->elements = new T[elements_size];
+    if (elements_size <= SUBSETBUFFER_INLINE) {
+      this->elements = this->inlineElements;
+      this->index = this->inlineIndex;
+    } else {
+      this->elements = new T[elements_size];
+      this->index = new T[elements_size];
+    }
+
     for (int i = 0; i < elements_size; i++)
       this->elements[i] = elements[i];
     quick_sort<T> (this->elements, elements_size);
 
-
-    this->index = NULL;
+    this->started = false;
   }
 
   ~subsetBuffer() {
-    delete[] this->elements;
-    if (this->index != NULL)
+    if (this->elements != this->inlineElements) {
+      delete[] this->elements;
       delete[] this->index;
+    }
   }
 };
 
@@ -116,8 +174,8 @@ template <class T> bool __nextSubset__(T* subset, subsetBuffer<T>& buffer, bool
   if (buffer.subset_size > buffer.elements_size)
     return false;
 
-  if (buffer.index == NULL) {
-    buffer.index = new T[buffer.subset_size];
+  if (!buffer.started) {
+    buffer.started = true;
 
     for (int i = 0; i < buffer.subset_size; i++)
       buffer.index[i] = i;
@@ -184,6 +242,15 @@ inline int factorial(int n) {
   }
 }
 
+// Compile-time factorial, for sizing arrays
+template <int n> struct Factorial {
+  enum { value = n * Factorial<n - 1>::value };
+};
+
+template <> struct Factorial<0> {
+  enum { value = 1 };
+};
+
 inline int binomial(int n, int k) {
   assert(n >= 0);
   assert(k >= 0);
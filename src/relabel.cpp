@@ -0,0 +1,129 @@
+#include "relabel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RELABEL_SIMD
+#include <immintrin.h>
+#endif
+
+/* The lookup table of a relabelling is a 16-byte array with the new
+   indices of the top vertices in bytes 0-7 and those of the bottom
+   vertices in bytes 8-15, so that a single byte shuffle can look up any
+   endpoint. */
+
+static void fill_lookup_table(unsigned char* table, const CFINT* newIndexN, const CFINT* newIndexK) {
+  for (int v = 0; v < 8; v++) {
+    table[v]     = (newIndexN != NULL && v < MAXN) ? newIndexN[v] : v;
+    table[8 + v] = (newIndexK != NULL && v < MAXK) ? newIndexK[v] : v;
+  }
+}
+
+static inline CFINT relabel_key(CFINT key, const unsigned char* table) {
+  return (CFINT) ((table[(key >> 9) & 7] << 9) | (table[8 + ((key >> 6) & 7)] << 6)
+                  | (table[(key >> 3) & 7] << 3) | table[8 + (key & 7)]);
+}
+
+static void relabel_scalar(const CFINT* keys, CFINT* result, int n, const unsigned char* table) {
+  for (int i = 0; i < n; i++)
+    result[i] = relabel_key(keys[i], table);
+}
+
+#ifdef RELABEL_SIMD
+
+/* A key holds its endpoints in bits 9-11 (top), 6-8 (bottom), 3-5 (top)
+   and 0-2 (bottom). For a vector of 16-bit keys, the top endpoints are
+   moved into the two bytes of each key as shuffle indices, and so are the
+   bottom endpoints (offset by 8); after the shuffles they are shifted
+   back into place. */
+
+__attribute__((target("ssse3")))
+static void relabel_ssse3(const CFINT* keys, CFINT* result, int n, const unsigned char* table) {
+  const __m128i lookup = _mm_loadu_si128((const __m128i*) table);
+  const __m128i low3   = _mm_set1_epi16(0x0007);
+  const __m128i high3  = _mm_set1_epi16(0x0700);
+  const __m128i bottom = _mm_set1_epi16(0x0808);
+
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i*) &keys[i]);
+
+    __m128i topIndex = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(x, 3), low3),
+                                    _mm_and_si128(_mm_srli_epi16(x, 1), high3));
+    __m128i bottomIndex = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi16(x, 6), low3),
+                                                    _mm_and_si128(_mm_slli_epi16(x, 8), high3)), bottom);
+
+    __m128i top = _mm_shuffle_epi8(lookup, topIndex);
+    __m128i bot = _mm_shuffle_epi8(lookup, bottomIndex);
+
+    __m128i y = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(top, high3), 1),
+                                          _mm_slli_epi16(_mm_and_si128(top, low3), 3)),
+                             _mm_or_si128(_mm_slli_epi16(_mm_and_si128(bot, low3), 6),
+                                          _mm_srli_epi16(bot, 8)));
+    _mm_storeu_si128((__m128i*) &result[i], y);
+  }
+  relabel_scalar(&keys[i], &result[i], n - i, table);
+}
+
+__attribute__((target("avx2")))
+static void relabel_avx2(const CFINT* keys, CFINT* result, int n, const unsigned char* table) {
+  const __m256i lookup = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) table));
+  const __m256i low3   = _mm256_set1_epi16(0x0007);
+  const __m256i high3  = _mm256_set1_epi16(0x0700);
+  const __m256i bottom = _mm256_set1_epi16(0x0808);
+
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x = _mm256_loadu_si256((const __m256i*) &keys[i]);
+
+    __m256i topIndex = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(x, 3), low3),
+                                       _mm256_and_si256(_mm256_srli_epi16(x, 1), high3));
+    __m256i bottomIndex = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(x, 6), low3),
+                                                          _mm256_and_si256(_mm256_slli_epi16(x, 8), high3)), bottom);
+
+    __m256i top = _mm256_shuffle_epi8(lookup, topIndex);
+    __m256i bot = _mm256_shuffle_epi8(lookup, bottomIndex);
+
+    __m256i y = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(top, high3), 1),
+                                                _mm256_slli_epi16(_mm256_and_si256(top, low3), 3)),
+                                _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(bot, low3), 6),
+                                                _mm256_srli_epi16(bot, 8)));
+    _mm256_storeu_si256((__m256i*) &result[i], y);
+  }
+  relabel_ssse3(&keys[i], &result[i], n - i, table);
+}
+
+#endif // RELABEL_SIMD
+
+typedef void (*RelabelKernel)(const CFINT*, CFINT*, int, const unsigned char*);
+
+struct RelabelDispatch {
+  RelabelKernel kernel;
+  const char* name;
+
+  RelabelDispatch() {
+    kernel = &relabel_scalar;
+    name = "scalar";
+#ifdef RELABEL_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      kernel = &relabel_avx2;
+      name = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+      kernel = &relabel_ssse3;
+      name = "ssse3";
+    }
+#endif
+  }
+};
+
+static RelabelDispatch dispatch;
+
+void relabel_crossing_keys(const CFINT* keys, CFINT* result, int n,
+                           const CFINT* newIndexN, const CFINT* newIndexK) {
+  unsigned char table[16];
+  fill_lookup_table(table, newIndexN, newIndexK);
+  dispatch.kernel(keys, result, n, table);
+}
+
+const char* relabel_kernel_name() {
+  return dispatch.name;
+}
@@ -0,0 +1,20 @@
+#ifndef __RELABEL_H__
+#define __RELABEL_H__
+
+#include "turan.h"
+
+// Relabels n packed crossing keys (see brickvector.h): result[i] is keys[i]
+// with every top endpoint v replaced by newIndexN[v] and every bottom
+// endpoint v replaced by newIndexK[v]. Either table may be NULL to leave
+// that side unchanged. The edges of a crossing are not reordered, and
+// keys and result may be the same array.
+//
+// On processors with SSSE3 or AVX2 the lookups are done with byte
+// shuffles, 8 or 16 keys at a time; the kernel is selected at startup.
+void relabel_crossing_keys(const CFINT* keys, CFINT* result, int n,
+                           const CFINT* newIndexN, const CFINT* newIndexK);
+
+// Name of the selected kernel ("scalar", "ssse3" or "avx2")
+const char* relabel_kernel_name();
+
+#endif // __RELABEL_H__
@@ -0,0 +1,326 @@
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <bitset>
+#include <string.h>
+
+#include "restrictiontable.h"
+#include "brickvector.h"
+#include "crossingset.h"
+#include "permutation.h"
+#include "threads.h"
+
+// The header of a restriction file. It is followed by the table, as
+// flagCount * labellingCount * slotCount ints.
+#define RESTRICTIONFILE_MAGIC   "TURANRST"
+#define RESTRICTIONFILE_VERSION 1
+
+struct RestrictionFileHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t N, K, subN, subK, subNlabelled, subKlabelled;
+  int32_t flagCount, subFlagCount, labellingCount, slotCount;
+  uint64_t checksum;   // of the flags of both algebras
+};
+
+// The flags are handed out to the threads one at a time
+struct RestrictionBatch {
+  const RestrictionTable* table;
+  int* indices;
+  int count;
+  int next;
+};
+
+RestrictionTable::RestrictionTable(int N, int K, int subN, int subK, int subNlabelled, int subKlabelled) {
+  if ((subN > N) || (subK > K) || (subNlabelled > subN) || (subKlabelled > subK))
+    fatal_error("Cannot restrict flags with " << N << " top and " << K << " bottom vertices to subflags of shape ("
+                << subN << "," << subK << "," << subNlabelled << "," << subKlabelled << ").");
+
+  this->N = N;
+  this->K = K;
+  this->subN = subN;
+  this->subK = subK;
+  this->subNlabelled = subNlabelled;
+  this->subKlabelled = subKlabelled;
+  this->algebra = &BrickAlgebra::shared(N, K, 0, 0);
+  this->subFlagAlgebra = &BrickAlgebra::shared(subN, subK, subNlabelled, subKlabelled);
+  this->indices = NULL;
+
+  this->labellingCount = factorial(N) / factorial(N - subNlabelled) * factorial(K) / factorial(K - subKlabelled);
+
+  // the unlabelled vertices of the slots, chosen in the same order as in
+  // restrictFlag, by their positions among the vertices that are not
+  // labelled
+  int subNunlabelled = subN - subNlabelled;
+  int subKunlabelled = subK - subKlabelled;
+  int remainingNcount = N - subNlabelled, remainingKcount = K - subKlabelled;
+  CFINT positionsN[remainingNcount], positionsK[remainingKcount];
+  for (int i = 0; i < remainingNcount; i++) positionsN[i] = i;
+  for (int i = 0; i < remainingKcount; i++) positionsK[i] = i;
+
+  CFINT unlabelledN[N];
+  subsetBuffer<CFINT> bufferN1(positionsN, remainingNcount, subNunlabelled);
+  while (nextSubset(unlabelledN, bufferN1)) {
+    CFINT unlabelledK[K];
+    subsetBuffer<CFINT> bufferK1(positionsK, remainingKcount, subKunlabelled);
+    while (nextSubset(unlabelledK, bufferK1)) {
+      unsigned setN = 0, setK = 0;
+      for (int i = 0; i < subNunlabelled; i++) setN |= 1u << unlabelledN[i];
+      for (int i = 0; i < subKunlabelled; i++) setK |= 1u << unlabelledK[i];
+      this->slotN.push_back(setN);
+      this->slotK.push_back(setK);
+    }
+  }
+  this->slotCount = this->slotN.size();
+}
+
+const RestrictionTable& RestrictionTable::shared(int N, int K, int subN, int subK, int subNlabelled, int subKlabelled) {
+  static std::map<std::vector<int>, RestrictionTable*> tables;
+
+  std::vector<int> key(6);
+  key[0] = N;
+  key[1] = K;
+  key[2] = subN;
+  key[3] = subK;
+  key[4] = subNlabelled;
+  key[5] = subKlabelled;
+
+  RestrictionTable*& table = tables[key];
+  if (table == NULL) {
+    table = new RestrictionTable(N, K, subN, subK, subNlabelled, subKlabelled);
+    if (table->load()) {
+#if VERBOSITY >= 2
+      std::cout << "Loaded restrictions of (" << N << "," << K << ") to (" << subN << "," << subK << ","
+                << subNlabelled << "," << subKlabelled << ") from " << table->fileName() << "." << std::endl;
+#endif
+    } else {
+      table->build();
+      table->save();
+    }
+  }
+  return *table;
+}
+
+void RestrictionTable::build() {
+  int threadCount = get_thread_count();
+  int flagCount = algebra->size();
+
+#if VERBOSITY >= 2
+  std::cout << "Computing restrictions of (" << N << "," << K << ") to (" << subN << "," << subK << ","
+            << subNlabelled << "," << subKlabelled << ") ..." << std::flush;
+#endif
+
+  this->table.resize((size_t) flagCount * labellingCount * slotCount);
+  if (!this->table.empty()) {
+    RestrictionBatch batch = { this, &this->table[0], flagCount, 0 };
+    run_parallel(restrictFlags, &batch, std::min<int>(threadCount, flagCount));
+  }
+  this->indices = this->table.empty() ? NULL : &this->table[0];
+
+#if VERBOSITY >= 2
+  std::cout << " Done";
+  if (threadCount > 1)
+    std::cout << " (" << threadCount << " threads)";
+  std::cout << "." << std::endl;
+#endif
+}
+
+void RestrictionTable::restrictFlags(void* argument, int, int) {
+  RestrictionBatch* batch = (RestrictionBatch*) argument;
+  const RestrictionTable* table = batch->table;
+  while (true) {
+    int F = __sync_fetch_and_add(&batch->next, 1);
+    if (F >= batch->count)
+      break;
+    table->restrictFlag(F, &batch->indices[(size_t) F * table->labellingCount * table->slotCount]);
+  }
+}
+
+// Writes the indices of the subflags of flag F, for every labelling and
+// every slot, to row
+void RestrictionTable::restrictFlag(int F, int* row) const {
+  int subNunlabelled = subN - subNlabelled;
+  int subKunlabelled = subK - subKlabelled;
+
+  // construct sets seqN = {0, ..., N-1} and seqK = {0, ..., K-1}
+
+  CFINT seqN[N];
+  for (int i = 0; i < N; i++) seqN[i] = i;
+  CFINT seqK[K];
+  for (int i = 0; i < K; i++) seqK[i] = i;
+
+  // the subflags are cut out of the crossing set of the flag
+  CrossingSet flag(algebra->getFlagList()[F]);
+
+  int labelling = 0;
+
+  // generate all ordered subsets labelN of seqN = {0, ..., N-1}
+  CFINT labelN[subNlabelled];
+  subsetBuffer<CFINT> bufferN(seqN, N, subNlabelled);
+
+  while (nextOrderedSubset(labelN, bufferN)) {
+    // generate all subsets labelK of seqK = {0, ..., K-1}
+    CFINT labelK[subKlabelled];
+    subsetBuffer<CFINT> bufferK(seqK, K, subKlabelled);
+    while (nextOrderedSubset(labelK, bufferK)) {
+      int* slots = &row[labelling * slotCount];
+      int slot = 0;
+
+      // put labelled vertices into bitsets
+      std::bitset<MAXN> setLabelN;
+      for (int i = 0; i < subNlabelled; i++) setLabelN.set(labelN[i]);
+      std::bitset<MAXN> setLabelK;
+      for (int i = 0; i < subKlabelled; i++) setLabelK.set(labelK[i]);
+
+      // construct arrays of unlabelled vertices
+      CFINT remainingN[N], remainingK[K];
+      for (int i = 0, t = 0; i < N; i++)
+        if (!setLabelN.test(i))
+          remainingN[t++] = i;
+      for (int i = 0, t = 0; i < K; i++)
+        if (!setLabelK.test(i))
+          remainingK[t++] = i;
+
+      // generate all subsets of unlabelled N vertices
+      CFINT unlabelledN[N];
+      subsetBuffer<CFINT> bufferN1(remainingN, N - subNlabelled, subNunlabelled);
+
+      while (nextSubset(unlabelledN, bufferN1)) {
+        // generate all subsets of unlabelled K vertices
+        CFINT unlabelledK[K];
+        subsetBuffer<CFINT> bufferK1(remainingK, K - subKlabelled, subKunlabelled);
+        while (nextSubset(unlabelledK, bufferK1)) {
+          // the labelled vertices come first, then the unlabelled ones,
+          // then the vertices that are deleted
+          CFINT newIndexN[N], newIndexK[K];
+
+          for (int i = 0; i < N; i++) newIndexN[i] = -1;
+          for (int i = 0; i < K; i++) newIndexK[i] = -1;
+
+          int iN = 0, iK = 0;
+          for (int i = 0; i < subNlabelled; i++)
+            newIndexN[labelN[i]] = iN++;
+          for (int i = 0; i < subNunlabelled; i++)
+            newIndexN[unlabelledN[i]] = iN++;
+          for (int i = 0; i < N; i++)
+            if (newIndexN[i] == -1)
+              newIndexN[i] = iN++;
+
+          for (int i = 0; i < subKlabelled; i++)
+            newIndexK[labelK[i]] = iK++;
+          for (int i = 0; i < subKunlabelled; i++)
+            newIndexK[unlabelledK[i]] = iK++;
+          for (int i = 0; i < K; i++)
+            if (newIndexK[i] == -1)
+              newIndexK[i] = iK++;
+
+          // construct subflag from the vertices that get an index
+          // below subN and subK
+          unsigned keptN = 0, keptK = 0;
+          for (int i = 0; i < N; i++)
+            if (newIndexN[i] < subN) keptN |= 1u << i;
+          for (int i = 0; i < K; i++)
+            if (newIndexK[i] < subK) keptK |= 1u << i;
+
+          CrossingSet crossings = flag;
+          crossings.keepVertices(keptN, keptK);
+          crossings.relabel(newIndexN, newIndexK);
+          crossings.setShape(subN, subK, subNlabelled, subKlabelled);
+
+          slots[slot++] = subFlagAlgebra->getIndex(crossings);
+        }
+      }
+      assert(slot == slotCount);
+      labelling++;
+    }
+  }
+  assert(labelling == labellingCount);
+}
+
+std::string RestrictionTable::fileName() const {
+  std::stringstream fileName;
+  fileName << "restriction" << N << K << "_" << subN << subK << subNlabelled << subKlabelled << ".bin";
+  return fileName.str();
+}
+
+// A hash of the flags of both algebras, in order, so that a saved table
+// is only used for the same flags
+uint64_t RestrictionTable::flagChecksum() const {
+  uint64_t checksum = algebra->size() * 0x100000001ULL + subFlagAlgebra->size();
+  const BrickAlgebra* algebras[2] = { algebra, subFlagAlgebra };
+  for (int a = 0; a < 2; a++) {
+    const FlagStore& flags = algebras[a]->getFlagList();
+    for (int F = 0; F < flags.size(); F++) {
+      checksum = (checksum ^ packed_vector_hash64(flags[F].packedVector())) * 0x9E3779B97F4A7C15ULL;
+      checksum ^= checksum >> 32;
+    }
+  }
+  return checksum;
+}
+
+bool RestrictionTable::load() {
+  if (!this->file.open(fileName()))
+    return false;
+
+  // a table of other flags or from another version of the program is
+  // ignored, and replaced
+  RestrictionFileHeader header;
+  size_t length = (size_t) algebra->size() * labellingCount * slotCount;
+  bool valid = (this->file.size() == sizeof(header) + sizeof(int) * length);
+  if (valid) {
+    memcpy(&header, this->file.begin(), sizeof(header));
+    valid = (memcmp(header.magic, RESTRICTIONFILE_MAGIC, 8) == 0) && (header.version == RESTRICTIONFILE_VERSION)
+            && (header.N == N) && (header.K == K) && (header.subN == subN) && (header.subK == subK)
+            && (header.subNlabelled == subNlabelled) && (header.subKlabelled == subKlabelled)
+            && (header.flagCount == algebra->size()) && (header.subFlagCount == subFlagAlgebra->size())
+            && (header.labellingCount == labellingCount) && (header.slotCount == slotCount)
+            && (header.checksum == flagChecksum());
+  }
+
+  // the checksum does not cover the table itself, so a damaged table is
+  // recognized by its indices
+  const int* fileIndices = valid ? (const int*) (this->file.begin() + sizeof(header)) : NULL;
+  int subFlagCount = subFlagAlgebra->size();
+  for (size_t i = 0; valid && (i < length); i++)
+    valid = (fileIndices[i] >= -1) && (fileIndices[i] < subFlagCount);
+
+  if (!valid) {
+    this->file.close();
+    return false;
+  }
+
+  this->indices = fileIndices;
+  return true;
+}
+
+void RestrictionTable::save() const {
+  RestrictionFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RESTRICTIONFILE_MAGIC, 8);
+  header.version = RESTRICTIONFILE_VERSION;
+  header.N = N;
+  header.K = K;
+  header.subN = subN;
+  header.subK = subK;
+  header.subNlabelled = subNlabelled;
+  header.subKlabelled = subKlabelled;
+  header.flagCount = algebra->size();
+  header.subFlagCount = subFlagAlgebra->size();
+  header.labellingCount = labellingCount;
+  header.slotCount = slotCount;
+  header.checksum = flagChecksum();
+
+  // written to a temporary file first, as a snapshot of an algebra is
+  std::string tableFileName = fileName();
+  std::string tempFileName = tableFileName + ".tmp";
+  std::ofstream file(tempFileName.c_str(), std::ios::binary);
+  file.write((const char*) &header, sizeof(header));
+  if (!this->table.empty())
+    file.write((const char*) &this->table[0], sizeof(int) * this->table.size());
+  file.close();
+
+  if (!file || (rename(tempFileName.c_str(), tableFileName.c_str()) != 0))
+    remove(tempFileName.c_str());
+}
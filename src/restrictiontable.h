@@ -0,0 +1,93 @@
+#ifndef __RESTRICTIONTABLE_H__
+#define __RESTRICTIONTABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "brickalgebra.h"
+#include "mappedfile.h"
+
+/* The restrictions of the flags of an algebra with N top and K bottom
+   vertices (and no labelled vertices) to subflags with subN top and subK
+   bottom vertices, of which subNlabelled and subKlabelled are labelled.
+
+   A restriction is given by a labelling and a slot. The labelling picks
+   the labelled vertices, in order (labelN of size subNlabelled and labelK
+   of size subKlabelled). The slot picks the unlabelled vertices among the
+   other vertices (unlabelledN and unlabelledK). The labellings and the
+   slots are numbered in the order in which nextOrderedSubset and
+   nextSubset list them. The table holds, for every flag, labelling and
+   slot, the index of the subflag in the subflag algebra.
+
+   A table is computed once per shape and saved (restrictionNK_nknlkl.bin,
+   see RestrictionFileHeader); later runs map the file into memory instead
+   of computing the table again, as long as the flags of both algebras are
+   the same. */
+class RestrictionTable {
+ private:
+  int N, K, subN, subK, subNlabelled, subKlabelled;
+  const BrickAlgebra* algebra;
+  const BrickAlgebra* subFlagAlgebra;
+  int labellingCount, slotCount;
+
+  // the unlabelled vertices of every slot, as a set of positions among
+  // the top (bottom) vertices that are not labelled
+  std::vector<unsigned> slotN, slotK;
+
+  // the table, either computed or in the mapped file
+  std::vector<int> table;
+  MappedFile file;
+  const int* indices;
+
+  RestrictionTable(int N, int K, int subN, int subK, int subNlabelled, int subKlabelled);
+  RestrictionTable(const RestrictionTable&);
+  RestrictionTable& operator = (const RestrictionTable&);
+
+  void build();
+  static void restrictFlags(void* argument, int thread, int threadCount);
+  void restrictFlag(int F, int* row) const;
+
+  std::string fileName() const;
+  uint64_t flagChecksum() const;
+  bool load();
+  void save() const;
+
+ public:
+  // the table of the given shape, which is constructed the first time it
+  // is requested and kept for the rest of the program; the algebras are
+  // those of BrickAlgebra::shared
+  static const RestrictionTable& shared(int N, int K, int subN, int subK, int subNlabelled, int subKlabelled);
+
+  const BrickAlgebra& getAlgebra() const {
+    return *algebra;
+  }
+  const BrickAlgebra& getSubFlagAlgebra() const {
+    return *subFlagAlgebra;
+  }
+
+  int labellings() const {
+    return labellingCount;
+  }
+  int slots() const {
+    return slotCount;
+  }
+
+  // the unlabelled vertices of a slot (bit i stands for the i-th top or
+  // bottom vertex that is not labelled)
+  unsigned unlabelledN(int slot) const {
+    return slotN[slot];
+  }
+  unsigned unlabelledK(int slot) const {
+    return slotK[slot];
+  }
+
+  // the indices of the subflags of flag F for a labelling, one per slot;
+  // -1 for a subflag that is not in the subflag algebra
+  const int* restrictions(int F, int labelling) const {
+    return &indices[((size_t) F * labellingCount + labelling) * slotCount];
+  }
+};
+
+#endif // __RESTRICTIONTABLE_H__
@@ -24,10 +24,9 @@ void writeCrossingsM(const BrickAlgebra& variables) {
   crossingsFile << "   cr = [";
 
   // retrieve list of variables
-  const vector<Configuration> & flagList = variables.getFlagList();
-  vector<Configuration>::const_iterator flagIterator;
-  for (flagIterator = flagList.begin(); flagIterator < flagList.end(); ++flagIterator)
-    crossingsFile << flagIterator->crossingCount() << " ";
+  const FlagStore& flagList = variables.getFlagList();
+  for (int F = 0; F < flagList.size(); F++)
+    crossingsFile << flagList[F].crossingCount() << " ";
   crossingsFile << "];" << endl;
   crossingsFile.close();
 }
@@ -47,8 +46,7 @@ int main() {
   int N = 3;
   int K = 3;
 
-  BrickAlgebra variables(N, K, 0, 0);
-  variables.constructElements();
+  const BrickAlgebra& variables = BrickAlgebra::shared(N, K, 0, 0);
 
   writeVariables(variables);
   writeParametersM(N, K, variables.size());
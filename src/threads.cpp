@@ -0,0 +1,88 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "threads.h"
+#include "turan.h"
+
+static int threadCount = -1;
+
+static int processorCount() {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (int) count : 1;
+}
+
+void set_thread_count(int count) {
+  if (count < 0)
+    fatal_error("The number of threads cannot be negative.");
+  threadCount = (count == 0) ? processorCount() : count;
+}
+
+int get_thread_count() {
+  if (threadCount < 0) {
+    const char* value = getenv("TURAN_THREADS");
+    if ((value != NULL) && (*value != 0)) {
+      char* end;
+      long count = strtol(value, &end, 10);
+      if ((*end != 0) || (count < 0))
+        fatal_error("TURAN_THREADS should be a nonnegative integer, but is '" << value << "'.");
+      set_thread_count((int) count);
+    } else
+      threadCount = 1;
+  }
+  return threadCount;
+}
+
+void parse_thread_options(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (((strcmp(argv[i], "-t") == 0) || (strcmp(argv[i], "--threads") == 0)) && (i + 1 < argc)) {
+      const char* value = argv[++i];
+      char* end;
+      long count = strtol(value, &end, 10);
+      if ((*value == 0) || (*end != 0) || (count < 0))
+        fatal_error("The number of threads should be a nonnegative integer, but is '" << value << "'.");
+      set_thread_count((int) count);
+    } else
+      fatal_error("Usage: " << argv[0] << " [-t threads]\n"
+                  "The number of threads can also be set with the environment variable TURAN_THREADS; 0 means one per processor.");
+  }
+}
+
+struct ThreadArguments {
+  ParallelTask task;
+  void* argument;
+  int thread, threadCount;
+};
+
+static void* runThread(void* arguments) {
+  ThreadArguments* a = (ThreadArguments*) arguments;
+  a->task(a->argument, a->thread, a->threadCount);
+  return NULL;
+}
+
+void run_parallel(ParallelTask task, void* argument, int threadCount) {
+  if (threadCount <= 1) {
+    task(argument, 0, 1);
+    return;
+  }
+
+  std::vector<pthread_t> threads(threadCount);
+  std::vector<ThreadArguments> arguments(threadCount);
+  for (int t = 0; t < threadCount; t++) {
+    arguments[t].task = task;
+    arguments[t].argument = argument;
+    arguments[t].thread = t;
+    arguments[t].threadCount = threadCount;
+  }
+
+  for (int t = 1; t < threadCount; t++)
+    if (pthread_create(&threads[t], NULL, runThread, &arguments[t]) != 0)
+      fatal_error("Could not start thread " << t << ".");
+
+  runThread(&arguments[0]);
+
+  for (int t = 1; t < threadCount; t++)
+    pthread_join(threads[t], NULL);
+}
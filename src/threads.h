@@ -0,0 +1,22 @@
+#ifndef __THREADS_H__
+#define __THREADS_H__
+
+// The number of threads used by parallel computations. It is set with
+// set_thread_count, e.g. from a command-line option; otherwise it is
+// read from the environment variable TURAN_THREADS, and it is 1 if that
+// is not set either. A count of 0 means one thread per processor.
+void set_thread_count(int count);
+int get_thread_count();
+
+// Sets the number of threads from the command line of a program, which
+// takes no other arguments than -t (or --threads) followed by a count;
+// anything else is an error that shows the usage.
+void parse_thread_options(int argc, char* argv[]);
+
+// Runs task(argument, thread, threadCount) for thread = 0, ...,
+// threadCount - 1, each on its own thread (thread 0 on the calling
+// thread), and returns when all of them have finished.
+typedef void (*ParallelTask)(void* argument, int thread, int threadCount);
+void run_parallel(ParallelTask task, void* argument, int threadCount);
+
+#endif
@@ -26,6 +26,7 @@ typedef short CFINT;
 			exit(1); }
 #define MAXN 6
 #define MAXK 6
+#define MAXNK (MAXN > MAXK ? MAXN : MAXK)
 
 
 #define STR_HELPER(x) #x